@@ -0,0 +1,337 @@
+#include "analysis.h"
+#include "config.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+#include <cstring>
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+
+using namespace std;
+
+AnalysisView analysisView = VIEW_NORMAL;
+bool analysisColors = false;
+
+// Fragment counts up to this level get their own color; above it, white
+static const int OVERDRAW_LEVELS = 15;
+// Rows in each table of the cost report
+static const size_t REPORT_ROWS = 10;
+
+static const char* viewNames[VIEW_COUNT] = { "normal", "overdraw", "triangles", "density" };
+
+// One model drawn in the last coverage pass, in traversal order
+struct DrawRecord {
+    const Group* group;
+    const Model* model;
+    long long triangles;
+    long long pixels;  // visible pixels (after depth test)
+};
+
+static vector<DrawRecord> draws;
+static size_t drawIndex = 0;          // model being drawn in the visible pass
+static bool coveragePass = false;
+static bool coverageValid = false;    // draws has this frame's pixel counts
+static long long viewportPixels = 0;
+static bool reportPending = false;
+
+// Fragments per pixel of the last overdraw pass, for the report
+struct OverdrawStats {
+    bool valid;
+    long long coveredPixels;
+    long long fragments;
+    int maxLayers;
+    long long pixelsAtFour;  // pixels shaded 4 or more times
+};
+static OverdrawStats overdraw;
+
+// ============================================================================
+// VIEW SELECTION
+// ============================================================================
+
+bool parseAnalysisView(const char* name, AnalysisView& view) {
+    for (int v = 0; v < VIEW_COUNT; v++) {
+        if (strcmp(name, viewNames[v]) == 0) {
+            view = (AnalysisView)v;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* analysisViewName(AnalysisView view) {
+    return view < VIEW_COUNT ? viewNames[view] : "?";
+}
+
+void cycleAnalysisView() {
+    analysisView = (AnalysisView)((analysisView + 1) % VIEW_COUNT);
+    string legend = analysisLegend();
+    cout << "→ View: " << analysisViewName(analysisView);
+    if (!legend.empty()) cout << " (" << legend << ")";
+    cout << endl;
+}
+
+void requestCostReport() {
+    reportPending = true;
+}
+
+bool coveragePassNeeded() {
+    return analysisView == VIEW_DENSITY || reportPending;
+}
+
+string analysisLegend() {
+    switch (analysisView) {
+        case VIEW_OVERDRAW:  return "overdraw: fragments per pixel, 1 (blue) to 15 (red), more in white";
+        case VIEW_TRIANGLES: return "triangles per model: 1 (blue) to 1M (red), log scale";
+        case VIEW_DENSITY:   return "triangles per covered pixel: 0.01 (blue) to 100 (red), log scale";
+        default:             return "";
+    }
+}
+
+/**
+ * Blue → cyan → green → yellow → red for t in [0, 1]
+ */
+static void heatColor(float t, float& r, float& g, float& b) {
+    t = max(0.0f, min(1.0f, t)) * 4.0f;
+    if (t < 1.0f)      { r = 0.0f;     g = t;        b = 1.0f; }
+    else if (t < 2.0f) { r = 0.0f;     g = 1.0f;     b = 2.0f - t; }
+    else if (t < 3.0f) { r = t - 2.0f; g = 1.0f;     b = 0.0f; }
+    else               { r = 1.0f;     g = 4.0f - t; b = 0.0f; }
+}
+
+// ============================================================================
+// COVERAGE PASS
+// ============================================================================
+
+void beginCoveragePass() {
+    draws.clear();
+    coveragePass = true;
+    analysisColors = true;
+    glPushAttrib(GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT | GL_POLYGON_BIT);
+    glDisable(GL_DITHER);  // ids must reach the framebuffer exactly
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void endCoveragePass() {
+    coveragePass = false;
+    analysisColors = false;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLint redBits = 0, greenBits = 0, blueBits = 0;
+    glGetIntegerv(GL_RED_BITS, &redBits);
+    glGetIntegerv(GL_GREEN_BITS, &greenBits);
+    glGetIntegerv(GL_BLUE_BITS, &blueBits);
+    viewportPixels = (long long)viewport[2] * viewport[3];
+    if (redBits >= 8 && greenBits >= 8 && blueBits >= 8) {
+        vector<unsigned char> pixels(viewportPixels * 3);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(viewport[0], viewport[1], viewport[2], viewport[3], GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+        for (long long i = 0; i < viewportPixels; i++) {
+            const unsigned char* p = &pixels[i * 3];
+            size_t id = p[0] | (p[1] << 8) | (p[2] << 16);
+            if (id > 0 && id <= draws.size()) draws[id - 1].pixels++;
+        }
+        coverageValid = true;
+    } else {
+        static bool warned = false;
+        if (!warned) cerr << "Coverage needs 8 bits per color channel; pixel counts unavailable" << endl;
+        warned = true;
+    }
+
+    glPopAttrib();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+// ============================================================================
+// VISIBLE PASS
+// ============================================================================
+
+void beginAnalysisPass() {
+    drawIndex = 0;
+    analysisColors = analysisView == VIEW_TRIANGLES || analysisView == VIEW_DENSITY;
+    overdraw.valid = false;
+    if (analysisView == VIEW_OVERDRAW) {
+        // Count every fragment, hidden ones included; the colors are replaced by the heat map
+        glClearStencil(0);
+        glClear(GL_STENCIL_BUFFER_BIT);
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_INCR, GL_INCR);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    }
+}
+
+void setAnalysisModelColor(const Group& group, const Model& model) {
+    long long triangles = model.mesh->vertexCount / 3;
+    if (coveragePass) {
+        DrawRecord record = { &group, &model, triangles, 0 };
+        draws.push_back(record);
+        size_t id = draws.size();  // 0 is the background
+        glColor3ub(id & 0xFF, (id >> 8) & 0xFF, (id >> 16) & 0xFF);
+        return;
+    }
+
+    float t = 0.0f;
+    if (analysisView == VIEW_DENSITY) {
+        // Same traversal as the coverage pass, so the index finds the same model
+        if (coverageValid && drawIndex < draws.size() && draws[drawIndex].model == &model) {
+            long long pixels = draws[drawIndex].pixels;
+            t = pixels > 0 ? (float)(log10((double)triangles / pixels) + 2.0) / 4.0f : 1.0f;
+        }
+    } else if (triangles > 0) {
+        t = (float)log10((double)triangles) / 6.0f;
+    }
+    drawIndex++;
+    float r, g, b;
+    heatColor(t, r, g, b);
+    glColor3f(r, g, b);
+}
+
+static void measureOverdraw() {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    long long count = (long long)viewport[2] * viewport[3];
+    vector<unsigned char> layers(count);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(viewport[0], viewport[1], viewport[2], viewport[3], GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, layers.data());
+    overdraw = OverdrawStats();
+    for (long long i = 0; i < count; i++) {
+        int n = layers[i];
+        if (n == 0) continue;
+        overdraw.coveredPixels++;
+        overdraw.fragments += n;
+        overdraw.maxLayers = max(overdraw.maxLayers, n);
+        if (n >= 4) overdraw.pixelsAtFour++;
+    }
+    overdraw.valid = true;
+}
+
+/**
+ * Paint the stencil counts over the whole viewport, one quad per level
+ */
+static void drawOverdrawHeatMap() {
+    glPushAttrib(GL_ENABLE_BIT | GL_POLYGON_BIT | GL_CURRENT_BIT | GL_STENCIL_BUFFER_BIT);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0, 1, 0, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    for (int level = 1; level <= OVERDRAW_LEVELS + 1; level++) {
+        if (level <= OVERDRAW_LEVELS) {
+            float r, g, b;
+            heatColor((level - 1) / (float)(OVERDRAW_LEVELS - 1), r, g, b);
+            glColor3f(r, g, b);
+            glStencilFunc(GL_EQUAL, level, 0xFF);
+        } else {
+            glColor3f(1.0f, 1.0f, 1.0f);
+            glStencilFunc(GL_LESS, OVERDRAW_LEVELS, 0xFF);  // OVERDRAW_LEVELS < count
+        }
+        glBegin(GL_QUADS);
+        glVertex2f(0.0f, 0.0f);
+        glVertex2f(1.0f, 0.0f);
+        glVertex2f(1.0f, 1.0f);
+        glVertex2f(0.0f, 1.0f);
+        glEnd();
+    }
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+}
+
+// ============================================================================
+// REPORT
+// ============================================================================
+
+static string drawLabel(const DrawRecord& d) {
+    string label = d.model->file;
+    if (!d.group->sourceLines.empty()) label += " (line " + to_string(d.group->sourceLines.front()) + ")";
+    return label;
+}
+
+static void printDrawRows(const vector<DrawRecord>& rows, ostream& out) {
+    out << "    " << right << setw(10) << "tri/px" << setw(12) << "triangles" << setw(10) << "pixels"
+        << "  " << left << "model" << right << "\n";
+    for (size_t i = 0; i < rows.size() && i < REPORT_ROWS; i++) {
+        const DrawRecord& d = rows[i];
+        out << "    " << setw(10);
+        if (d.pixels > 0) out << (double)d.triangles / d.pixels; else out << "hidden";
+        out << setw(12) << d.triangles << setw(10) << d.pixels << "  " << drawLabel(d) << "\n";
+    }
+}
+
+static void printCostReport(ostream& out) {
+    long long triangles = 0, pixels = 0, hiddenDraws = 0, hiddenTriangles = 0;
+    for (const auto& d : draws) {
+        triangles += d.triangles;
+        pixels += d.pixels;
+        if (d.pixels == 0) {
+            hiddenDraws++;
+            hiddenTriangles += d.triangles;
+        }
+    }
+
+    out << fixed << setprecision(1);
+    out << "Cost report for " << currentConfigFile << " (view " << analysisViewName(analysisView) << ")\n";
+    out << "  Draws " << draws.size() << ", triangles " << triangles << ", visible pixels " << pixels
+        << " (" << (viewportPixels ? 100.0 * pixels / viewportPixels : 0.0) << "% of the view)\n";
+    out << "  Hidden or off-screen: " << hiddenDraws << " draws, " << hiddenTriangles << " triangles ("
+        << (triangles ? 100.0 * hiddenTriangles / triangles : 0.0) << "% of the vertex work)\n";
+    if (overdraw.valid) {
+        out << "  Overdraw: " << setprecision(2)
+            << (overdraw.coveredPixels ? (double)overdraw.fragments / overdraw.coveredPixels : 0.0)
+            << setprecision(1) << " fragments per covered pixel, max " << overdraw.maxLayers << ", "
+            << (overdraw.coveredPixels ? 100.0 * overdraw.pixelsAtFour / overdraw.coveredPixels : 0.0)
+            << "% of covered pixels shaded 4+ times\n";
+    }
+
+    // Hidden draws cost vertex work for nothing, so they lead the density table
+    vector<DrawRecord> sorted = draws;
+    sort(sorted.begin(), sorted.end(), [](const DrawRecord& a, const DrawRecord& b) {
+        if ((a.pixels == 0) != (b.pixels == 0)) return a.pixels == 0;
+        if (a.pixels == 0) return a.triangles > b.triangles;
+        return (double)a.triangles / a.pixels > (double)b.triangles / b.pixels;
+    });
+    out << setprecision(2);
+    out << "  Most triangles per visible pixel:\n";
+    printDrawRows(sorted, out);
+    sort(sorted.begin(), sorted.end(), [](const DrawRecord& a, const DrawRecord& b) {
+        return a.triangles > b.triangles;
+    });
+    out << "  Most triangles:\n";
+    printDrawRows(sorted, out);
+    out << defaultfloat << setprecision(6);
+    out.flush();
+}
+
+void endAnalysisPass() {
+    analysisColors = false;
+    if (analysisView == VIEW_OVERDRAW) {
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        if (reportPending) measureOverdraw();
+        drawOverdrawHeatMap();
+        glDisable(GL_STENCIL_TEST);
+    }
+    if (reportPending && coverageValid) {
+        printCostReport(cout);
+        reportPending = false;
+    }
+    coverageValid = false;
+}
@@ -0,0 +1,79 @@
+#ifndef ANALYSIS_H
+#define ANALYSIS_H
+
+#include <string>
+#include "geometry.h"
+
+using namespace std;
+
+// ============================================================================
+// COST ANALYSIS VIEWS
+// ============================================================================
+
+// Diagnostic views that show where fill and vertex work go. The overdraw
+// view counts every fragment rasterized at each pixel (stencil increments
+// on depth pass and fail) and paints the counts as a heat map; the cost
+// views color each model by its triangle count or by its triangles per
+// covered pixel. Coverage comes from a pass that draws every model in a
+// unique color and reads the frame back, so the density view and the cost
+// report cost a readback per frame.
+
+enum AnalysisView {
+    VIEW_NORMAL,
+    VIEW_OVERDRAW,   // fragments per pixel as a heat map
+    VIEW_TRIANGLES,  // models colored by triangle count
+    VIEW_DENSITY,    // models colored by triangles per covered pixel
+    VIEW_COUNT
+};
+
+extern AnalysisView analysisView;
+extern bool analysisColors;  // models take their color from setAnalysisModelColor()
+
+/**
+ * Parse a view name ("normal", "overdraw", "triangles", "density"), returns false if unknown
+ */
+bool parseAnalysisView(const char* name, AnalysisView& view);
+
+const char* analysisViewName(AnalysisView view);
+
+/**
+ * Cycle normal → overdraw → triangles → density (key X)
+ */
+void cycleAnalysisView();
+
+/**
+ * Print the worst offenders after the next frame (key Z)
+ */
+void requestCostReport();
+
+/**
+ * Whether the frame needs a coverage pass (density view or a pending report)
+ */
+bool coveragePassNeeded();
+
+/**
+ * Around a draw of the scene graph in unique per-model colors: reads the
+ * frame back, counts the pixels of each model and clears the buffers
+ */
+void beginCoveragePass();
+void endCoveragePass();
+
+/**
+ * Around the visible draw of the scene graph: stencil counting and the heat
+ * map for the overdraw view, the pending report at the end
+ */
+void beginAnalysisPass();
+void endAnalysisPass();
+
+/**
+ * Set the color of the model about to be drawn (models are identified by
+ * their order in the traversal)
+ */
+void setAnalysisModelColor(const Group& group, const Model& model);
+
+/**
+ * One-line color key, shown with the FPS counter (empty in the normal view)
+ */
+string analysisLegend();
+
+#endif // ANALYSIS_H
@@ -0,0 +1,42 @@
+#include "arena.h"
+
+using namespace std;
+
+// ============================================================================
+// UPSTREAM (HEAP)
+// ============================================================================
+
+void* ArenaUpstream::do_allocate(size_t size, size_t alignment) {
+    bytes += size;
+    blocks++;
+    return pmr::new_delete_resource()->allocate(size, alignment);
+}
+
+void ArenaUpstream::do_deallocate(void* p, size_t size, size_t alignment) {
+    pmr::new_delete_resource()->deallocate(p, size, alignment);
+}
+
+bool ArenaUpstream::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+// ============================================================================
+// ARENA
+// ============================================================================
+
+Arena::Arena(size_t initialSize)
+    : bytes(0), allocations(0), buffer(initialSize, &upstream) {}
+
+void* Arena::do_allocate(size_t size, size_t alignment) {
+    bytes += size;
+    allocations++;
+    return buffer.allocate(size, alignment);
+}
+
+void Arena::do_deallocate(void*, size_t, size_t) {
+    // Monotonic: memory is only reclaimed when the whole arena goes away
+}
+
+bool Arena::do_is_equal(const pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
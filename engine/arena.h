@@ -0,0 +1,44 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+
+using namespace std;
+
+// ============================================================================
+// ARENA ALLOCATION
+// ============================================================================
+
+// Heap side of an arena: counts the blocks the arena reserves
+struct ArenaUpstream : public pmr::memory_resource {
+    size_t bytes;
+    size_t blocks;
+    ArenaUpstream() : bytes(0), blocks(0) {}
+
+protected:
+    void* do_allocate(size_t size, size_t alignment) override;
+    void do_deallocate(void* p, size_t size, size_t alignment) override;
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override;
+};
+
+// Monotonic arena: allocations are bump-pointer, deallocation is a no-op and
+// everything is released at once when the arena is destroyed. Used for a
+// scene graph and for each mesh's vertex list.
+struct Arena : public pmr::memory_resource {
+    size_t bytes;        // bytes handed out to containers
+    size_t allocations;  // number of allocations served
+    ArenaUpstream upstream;
+    pmr::monotonic_buffer_resource buffer;
+
+    explicit Arena(size_t initialSize = 16 * 1024);
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+protected:
+    void* do_allocate(size_t size, size_t alignment) override;
+    void do_deallocate(void* p, size_t size, size_t alignment) override;
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override;
+};
+
+#endif // ARENA_H
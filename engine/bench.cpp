@@ -0,0 +1,253 @@
+#include "bench.h"
+#include "rendering.h"
+#include "config.h"
+#include "optimize.h"
+#include "scheduler.h"
+#include "memory.h"
+#include "profiler.h"
+#include "camerapath.h"
+#include "analysis.h"
+#include "statsserver.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#endif
+
+using namespace std;
+
+extern shared_ptr<Scene> activeScene;
+
+// ============================================================================
+// OFFSCREEN CONTEXT
+// ============================================================================
+
+#ifdef HAVE_EGL
+
+struct OffscreenContext {
+    EGLDisplay display;
+    EGLSurface surface;
+    EGLContext context;
+    OffscreenContext() : display(EGL_NO_DISPLAY), surface(EGL_NO_SURFACE), context(EGL_NO_CONTEXT) {}
+    ~OffscreenContext() {
+        if (display == EGL_NO_DISPLAY) return;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+        if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+        eglTerminate(display);
+    }
+};
+
+/**
+ * Mesa's surfaceless platform needs neither X nor a GPU; other drivers
+ * fall back to their default display
+ */
+static EGLDisplay openDisplay() {
+#ifdef EGL_PLATFORM_SURFACELESS_MESA
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) return display;
+    }
+#endif
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL)) return display;
+    return EGL_NO_DISPLAY;
+}
+
+static bool createOffscreenContext(OffscreenContext& ctx, int width, int height) {
+    ctx.display = openDisplay();
+    if (ctx.display == EGL_NO_DISPLAY) {
+        cerr << "Benchmark: no EGL display available" << endl;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        cerr << "Benchmark: EGL driver has no desktop OpenGL" << endl;
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(ctx.display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+        cerr << "Benchmark: no EGL config with a pbuffer and depth buffer" << endl;
+        return false;
+    }
+
+    const EGLint surfaceAttribs[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    ctx.surface = eglCreatePbufferSurface(ctx.display, config, surfaceAttribs);
+    // The renderer uses the fixed-function pipeline, so no core profile
+    ctx.context = eglCreateContext(ctx.display, config, EGL_NO_CONTEXT, NULL);
+    if (ctx.surface == EGL_NO_SURFACE || ctx.context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(ctx.display, ctx.surface, ctx.surface, ctx.context)) {
+        cerr << "Benchmark: could not create an offscreen OpenGL context (EGL error 0x"
+             << hex << eglGetError() << dec << ")" << endl;
+        return false;
+    }
+    return true;
+}
+
+#endif // HAVE_EGL
+
+// ============================================================================
+// REPORT
+// ============================================================================
+
+static string jsonString(const string& s) {
+    string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c < 0x20) { out += ' '; continue; }
+        out += c;
+    }
+    return out + "\"";
+}
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+
+/**
+ * Sends cout to stderr while alive, so a report printed on stdout is the
+ * only thing there (`engine --bench cfg.xml > out.json` stays valid JSON
+ * whatever the loader, optimizer or cost report log)
+ */
+struct StdoutToStderr {
+    streambuf* stdoutBuffer;
+    explicit StdoutToStderr(bool active) : stdoutBuffer(nullptr) {
+        if (active) stdoutBuffer = cout.rdbuf(cerr.rdbuf());
+    }
+    void restore() {
+        if (stdoutBuffer) cout.rdbuf(stdoutBuffer);
+        stdoutBuffer = nullptr;
+    }
+    ~StdoutToStderr() { restore(); }
+};
+
+int runBenchmark(const char* configFile, const BenchOptions& options) {
+#ifndef HAVE_EGL
+    (void)configFile; (void)options;
+    cerr << "Benchmark mode needs EGL; rebuild the engine with EGL available" << endl;
+    return 1;
+#else
+    typedef chrono::steady_clock Clock;
+    StdoutToStderr logs(options.output.empty());
+
+    Clock::time_point loadStart = Clock::now();
+    currentConfigFile = configFile;
+    shared_ptr<Scene> scene = make_shared<Scene>();
+    if (!loadScene(configFile, *scene)) {
+        cerr << "Benchmark: could not load " << configFile << endl;
+        return 1;
+    }
+    applyScene(scene);
+    double loadMs = chrono::duration<double, milli>(Clock::now() - loadStart).count();
+    markMemory("applied");
+    if (options.memoryReport) printMemoryReport(*activeScene, cout);
+
+    OffscreenContext ctx;
+    if (!createOffscreenContext(ctx, windowWidth, windowHeight)) return 1;
+    string renderer = (const char*)glGetString(GL_RENDERER);
+
+    setupGL();
+    changeSize(windowWidth, windowHeight);
+    setFixedFrameStep(1000.0 / targetFPS);
+    long long trianglesPerFrame = measureSceneGraph(*activeScene, false).triangles;
+    if (!options.statsSocket.empty() && !startStatsServer(options.statsSocket, true)) return 1;
+
+    for (int i = 0; i < options.warmupFrames; i++) {
+        drawFrame();
+        glFinish();
+        profileLap(PHASE_SWAP);
+        profileFrameEnd();
+        pollStatsServer();
+    }
+
+    int measuredFrames = options.measuredFrames;
+    if (!options.replay.empty()) {
+        if (!startCameraReplay(options.replay, *activeScene, 1000.0 / targetFPS)) return 1;
+        measuredFrames = cameraReplayRemaining();
+    }
+
+    // glFinish makes each sample cover the rasterization, not just the submission
+    vector<double> frameMs;
+    frameMs.reserve(measuredFrames);
+    Clock::time_point runStart = Clock::now();
+    for (int i = 0; i < measuredFrames; i++) {
+        Clock::time_point start = Clock::now();
+        drawFrame();
+        glFinish();
+        profileLap(PHASE_SWAP);
+        profileFrameEnd();
+        cameraReplayFrameDone();
+        frameMs.push_back(chrono::duration<double, milli>(Clock::now() - start).count());
+        pollStatsServer();
+    }
+    double totalSeconds = chrono::duration<double>(Clock::now() - runStart).count();
+
+    // With an analysis view, one more untimed frame prints the cost report
+    if (analysisView != VIEW_NORMAL) {
+        requestCostReport();
+        drawFrame();
+        glFinish();
+    }
+
+    vector<double> sorted = frameMs;
+    sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double ms : frameMs) sum += ms;
+    bool measured = !sorted.empty();
+
+    ostringstream report;
+    report << "{\n"
+           << "  \"config\": " << jsonString(configFile) << ",\n"
+           << "  \"renderer\": " << jsonString(renderer) << ",\n"
+           << "  \"replay\": " << jsonString(options.replay) << ",\n"
+           << "  \"width\": " << windowWidth << ",\n"
+           << "  \"height\": " << windowHeight << ",\n"
+           << "  \"warmup_frames\": " << options.warmupFrames << ",\n"
+           << "  \"frames\": " << frameMs.size() << ",\n"
+           << "  \"load_ms\": " << loadMs << ",\n"
+           << "  \"frame_ms\": {\n"
+           << "    \"min\": " << (measured ? sorted.front() : 0.0) << ",\n"
+           << "    \"mean\": " << (measured ? sum / frameMs.size() : 0.0) << ",\n"
+           << "    \"p50\": " << (measured ? percentile(sorted, 50) : 0.0) << ",\n"
+           << "    \"p95\": " << (measured ? percentile(sorted, 95) : 0.0) << ",\n"
+           << "    \"p99\": " << (measured ? percentile(sorted, 99) : 0.0) << ",\n"
+           << "    \"max\": " << (measured ? sorted.back() : 0.0) << "\n"
+           << "  },\n"
+           << "  \"triangles_per_frame\": " << trianglesPerFrame << ",\n"
+           << "  \"triangles_per_second\": "
+           << (totalSeconds > 0.0 ? trianglesPerFrame * frameMs.size() / totalSeconds : 0.0) << ",\n"
+           << "  \"peak_rss_mb\": " << peakMemoryMB() << "\n"
+           << "}\n";
+
+    logs.restore();
+    if (options.output.empty()) {
+        cout << report.str();
+        cout.flush();
+    } else {
+        ofstream out(options.output.c_str());
+        if (!(out << report.str())) {
+            cerr << "Benchmark: could not write " << options.output << endl;
+            return 1;
+        }
+        cout << "Benchmark report written to " << options.output << endl;
+    }
+    return 0;
+#endif
+}
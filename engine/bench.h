@@ -0,0 +1,34 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <string>
+
+using namespace std;
+
+// ============================================================================
+// HEADLESS BENCHMARK
+// ============================================================================
+
+// Renders a config into an offscreen EGL pbuffer (no window or X server;
+// Mesa rasterizes in software when there is no GPU) for a fixed number of
+// frames and reports the timings as JSON. Animation advances by a fixed
+// step of 1000/targetFPS ms per frame, so every run draws the same frames.
+// With a replay the measured frames are the frames of the camera path.
+
+struct BenchOptions {
+    int warmupFrames;    // drawn before timing starts
+    int measuredFrames;  // drawn and timed
+    string output;       // JSON report file (empty = stdout)
+    bool memoryReport;   // print the memory report after loading
+    string replay;       // camera recording or config path to measure instead
+    string statsSocket;  // serve live stats while running (empty = off)
+    BenchOptions() : warmupFrames(60), measuredFrames(600), memoryReport(false) {}
+};
+
+/**
+ * Load a config offscreen, draw the warm-up and measured frames and write
+ * the report; returns the process exit code
+ */
+int runBenchmark(const char* configFile, const BenchOptions& options);
+
+#endif // BENCH_H
@@ -0,0 +1,225 @@
+#include "camerapath.h"
+#include "rendering.h"
+#include "menu.h"
+#include "profiler.h"
+#include "analysis.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+
+struct CameraFrame {
+    bool free;
+    float posX, posY, posZ;
+    float lookAtX, lookAtY, lookAtZ;
+    float upX, upY, upZ;
+    vector<unsigned char> keys;  // pressed before this frame
+};
+
+static ofstream recording;
+static vector<unsigned char> pendingKeys;
+
+static vector<CameraFrame> replay;
+static size_t replayNext = 0;
+static bool replaying = false;
+static vector<double> replayFrameMs;
+
+// ============================================================================
+// RECORDING
+// ============================================================================
+
+bool startCameraRecording(const string& filename, double frameStepMs) {
+    recording.open(filename.c_str());
+    if (!recording) {
+        cerr << "Could not open camera recording " << filename << endl;
+        return false;
+    }
+    recording << setprecision(9);  // enough digits to read back the same floats
+    recording << "step " << frameStepMs << "\n";
+    cout << "Recording camera path to " << filename << endl;
+    return true;
+}
+
+void recordCameraKey(unsigned char key) {
+    if (recording.is_open()) pendingKeys.push_back(key);
+}
+
+void recordCameraFrame(const Camera& camera) {
+    if (!recording.is_open() || replaying) return;
+    for (unsigned char key : pendingKeys) recording << "key " << (int)key << "\n";
+    pendingKeys.clear();
+    recording << "frame " << (freeCamera ? 1 : 0) << ' '
+              << camera.posX << ' ' << camera.posY << ' ' << camera.posZ << ' '
+              << camera.lookAtX << ' ' << camera.lookAtY << ' ' << camera.lookAtZ << ' '
+              << camera.upX << ' ' << camera.upY << ' ' << camera.upZ << "\n";
+}
+
+// ============================================================================
+// LOADING PATHS
+// ============================================================================
+
+static bool readRecording(const string& filename, double& frameStepMs) {
+    ifstream file(filename.c_str());
+    if (!file) return false;
+    string line;
+    vector<unsigned char> keys;
+    int lineNumber = 0;
+    while (getline(file, line)) {
+        lineNumber++;
+        istringstream iss(line);
+        string tag;
+        if (!(iss >> tag)) continue;
+        if (tag == "step") {
+            iss >> frameStepMs;
+        } else if (tag == "key") {
+            int code;
+            if (iss >> code) keys.push_back((unsigned char)code);
+        } else if (tag == "frame") {
+            CameraFrame f;
+            int free;
+            if (!(iss >> free >> f.posX >> f.posY >> f.posZ >> f.lookAtX >> f.lookAtY >> f.lookAtZ
+                      >> f.upX >> f.upY >> f.upZ)) {
+                cerr << "Camera recording " << filename << ": bad frame at line " << lineNumber << endl;
+                return false;
+            }
+            f.free = free != 0;
+            f.keys.swap(keys);
+            replay.push_back(f);
+        }
+    }
+    return true;
+}
+
+/**
+ * Uniform Catmull-Rom spline between p1 and p2
+ */
+static float catmullRom(float p0, float p1, float p2, float p3, float t) {
+    float t2 = t * t, t3 = t2 * t;
+    return 0.5f * (2.0f * p1 + (p2 - p0) * t +
+                   (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+/**
+ * Sample an authored path once per frame step
+ */
+static void samplePath(const CameraPath& path, double frameStepMs) {
+    const vector<CameraPathPoint>& pts = path.points;
+    double duration = pts.back().time - pts.front().time;
+    int frames = (int)(duration * 1000.0 / frameStepMs) + 1;
+    size_t segment = 0;
+    for (int i = 0; i < frames; i++) {
+        float time = pts.front().time + (float)(i * frameStepMs / 1000.0);
+        while (segment + 2 < pts.size() && pts[segment + 1].time <= time) segment++;
+
+        const CameraPathPoint& p1 = pts[segment];
+        const CameraPathPoint& p2 = pts[min(segment + 1, pts.size() - 1)];
+        const CameraPathPoint& p0 = pts[segment > 0 ? segment - 1 : segment];
+        const CameraPathPoint& p3 = pts[min(segment + 2, pts.size() - 1)];
+        float span = p2.time - p1.time;
+        float t = span > 0.0f ? min(max((time - p1.time) / span, 0.0f), 1.0f) : 0.0f;
+
+        CameraFrame f;
+        f.free = true;
+        f.posX = catmullRom(p0.x, p1.x, p2.x, p3.x, t);
+        f.posY = catmullRom(p0.y, p1.y, p2.y, p3.y, t);
+        f.posZ = catmullRom(p0.z, p1.z, p2.z, p3.z, t);
+        f.lookAtX = p1.lookAtX + (p2.lookAtX - p1.lookAtX) * t;
+        f.lookAtY = p1.lookAtY + (p2.lookAtY - p1.lookAtY) * t;
+        f.lookAtZ = p1.lookAtZ + (p2.lookAtZ - p1.lookAtZ) * t;
+        f.upX = 0.0f; f.upY = 1.0f; f.upZ = 0.0f;
+        replay.push_back(f);
+    }
+}
+
+bool startCameraReplay(const string& source, const Scene& scene, double frameStepMs) {
+    replay.clear();
+    replayNext = 0;
+    replayFrameMs.clear();
+
+    const CameraPath* path = nullptr;
+    for (const auto& p : scene.cameraPaths) {
+        if (p.name == source) path = &p;
+    }
+    if (path) {
+        samplePath(*path, frameStepMs);
+        cout << "Replaying camera path '" << source << "' (" << replay.size() << " frames)" << endl;
+    } else if (readRecording(source, frameStepMs)) {
+        cout << "Replaying camera recording " << source << " (" << replay.size() << " frames)" << endl;
+    } else {
+        cerr << "No camera path or recording named " << source << endl;
+        return false;
+    }
+    if (replay.empty()) {
+        cerr << "Camera path " << source << " has no frames" << endl;
+        return false;
+    }
+
+    setFixedFrameStep(frameStepMs);
+    frameProfiling = true;
+    replaying = true;
+    return true;
+}
+
+// ============================================================================
+// REPLAY
+// ============================================================================
+
+bool cameraReplayActive() {
+    return replaying;
+}
+
+/**
+ * Keys that change what is drawn; camera keys are covered by the recorded
+ * camera, and reloads, menus and exit are not replayed
+ */
+static void replayKey(unsigned char key) {
+    switch (key) {
+        case 'w': case 'W': if (!freeCamera) toggleWireframe(); break;
+        case 'a': case 'A': if (!freeCamera) toggleShowAxes(); break;
+        case 'c': case 'C': toggleCulling(); break;
+        case 'o': case 'O': toggleShowFPS(); break;
+        case 't': case 'T': toggleFrameStats(); break;
+        case 'p': case 'P': togglePhysicsPaused(); break;
+        case 'g': case 'G': toggleForceMethod(); break;
+        case 'x': case 'X': cycleAnalysisView(); break;
+        case 'z': case 'Z': requestCostReport(); break;
+    }
+}
+
+bool applyCameraReplayFrame(Camera& camera) {
+    if (replayNext >= replay.size()) return false;
+    const CameraFrame& f = replay[replayNext++];
+    for (unsigned char key : f.keys) replayKey(key);
+    freeCamera = f.free;
+    camera.posX = f.posX; camera.posY = f.posY; camera.posZ = f.posZ;
+    camera.lookAtX = f.lookAtX; camera.lookAtY = f.lookAtY; camera.lookAtZ = f.lookAtZ;
+    camera.upX = f.upX; camera.upY = f.upY; camera.upZ = f.upZ;
+    return true;
+}
+
+void cameraReplayFrameDone() {
+    if (!replaying || frameHistorySize() == 0) return;
+    replayFrameMs.push_back(frameHistory(0).totalMs);
+    if (replayNext >= replay.size()) replaying = false;
+}
+
+int cameraReplayRemaining() {
+    return replaying ? (int)(replay.size() - replayNext) : 0;
+}
+
+void printCameraReplaySummary() {
+    if (replayFrameMs.empty()) return;
+    vector<double> sorted = replayFrameMs;
+    sort(sorted.begin(), sorted.end());
+    double sum = 0.0;
+    for (double ms : sorted) sum += ms;
+    size_t n = sorted.size();
+    cout << "Replay finished: " << n << " frames, frame ms min " << sorted.front()
+         << ", avg " << sum / n << ", p95 " << percentile(sorted, 95) << ", p99 " << percentile(sorted, 99)
+         << ", max " << sorted.back() << endl;
+}
@@ -0,0 +1,70 @@
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+
+#include <string>
+#include "geometry.h"
+#include "scene.h"
+
+using namespace std;
+
+// ============================================================================
+// CAMERA PATH RECORDING AND REPLAY
+// ============================================================================
+
+// A recording stores, for every drawn frame, the resolved camera (position,
+// look-at, up) and the keys pressed before it. Both recording and replay
+// advance animation by a fixed step per frame, so a replay shows exactly
+// the recorded views and every run of it draws the same frames. Mouse input
+// is not stored separately: its effect is in the camera state.
+//
+// File format (text, one line per entry):
+//   step <ms per frame>
+//   key <code>                       (applies to the next frame)
+//   frame <free> <pos xyz> <lookAt xyz> <up xyz>
+
+/**
+ * Start recording every drawn frame to a file
+ */
+bool startCameraRecording(const string& filename, double frameStepMs);
+
+/**
+ * Record a key press (called by the keyboard handler)
+ */
+void recordCameraKey(unsigned char key);
+
+/**
+ * Record the camera of the frame being drawn
+ */
+void recordCameraFrame(const Camera& camera);
+
+/**
+ * Start replaying a <cameraPath> of the scene (by name) or a recording
+ * (by file); the fixed frame step is set to the recording's, or to
+ * frameStepMs for config paths. Per-frame timing is turned on.
+ */
+bool startCameraReplay(const string& source, const Scene& scene, double frameStepMs);
+
+bool cameraReplayActive();
+
+/**
+ * Apply the next replayed frame (keys, then camera); false once the
+ * replay is over
+ */
+bool applyCameraReplayFrame(Camera& camera);
+
+/**
+ * Collect the timing of the frame just finished (after profileFrameEnd)
+ */
+void cameraReplayFrameDone();
+
+/**
+ * Frames left to replay
+ */
+int cameraReplayRemaining();
+
+/**
+ * Print the frame time statistics of the whole replay
+ */
+void printCameraReplaySummary();
+
+#endif // CAMERAPATH_H
@@ -1,18 +1,20 @@
 #include "config.h"
 #include "model.h"
-#include <tinyxml2.h>
+#include "physics.h"
+#include "xmlstream.h"
+#include "snapshot.h"
+#include "optimize.h"
+#include "memory.h"
+#include "../include/trace.h"
 #include <iostream>
 #include <cstring>
 #include <cmath>
-
-#ifdef __APPLE__
-#include <GLUT/glut.h>
-#else
-#include <GL/glut.h>
-#endif
+#include <chrono>
+#include <vector>
+#include <map>
+#include <algorithm>
 
 using namespace std;
-using namespace tinyxml2;
 
 string currentConfigFile;
 
@@ -36,150 +38,395 @@ void parseHexColor(const char* hex, float& r, float& g, float& b) {
 // XML PARSING
 // ============================================================================
 
-Group parseGroup(XMLElement* groupElem) {
-    Group g;
-
-    // Parse transforms
-    XMLElement* transformElem = groupElem->FirstChildElement("transform");
-    if (transformElem) {
-        XMLElement* child = transformElem->FirstChildElement();
-        while (child) {
-            string name = child->Name();
-            Transform t;
-            if (name == "translate") {
-                t.type = TRANSLATE;
-                t.x = child->FloatAttribute("x", 0.0f);
-                t.y = child->FloatAttribute("y", 0.0f);
-                t.z = child->FloatAttribute("z", 0.0f);
-                g.transforms.push_back(t);
-            } else if (name == "rotate") {
-                t.type = ROTATE;
-                t.angle = child->FloatAttribute("angle", 0.0f);
-                t.x = child->FloatAttribute("x", 0.0f);
-                t.y = child->FloatAttribute("y", 0.0f);
-                t.z = child->FloatAttribute("z", 0.0f);
-                g.transforms.push_back(t);
-            } else if (name == "scale") {
-                t.type = SCALE;
-                t.x = child->FloatAttribute("x", 1.0f);
-                t.y = child->FloatAttribute("y", 1.0f);
-                t.z = child->FloatAttribute("z", 1.0f);
-                g.transforms.push_back(t);
+// What an open element means, decided by its name and its parent's kind
+enum ElementKind {
+    ELEMENT_IGNORED, ELEMENT_WORLD, ELEMENT_CAMERA, ELEMENT_CAMERA_PATH,
+    ELEMENT_GROUP, ELEMENT_USE, ELEMENT_TRANSFORM, ELEMENT_MODELS
+};
+
+struct OpenGroup {
+    Group* group;
+    bool prototype;                         // inside a <define>
+    bool hadTransform, hadModels, hadBody;  // only the first of each is used
+    double traceStartUs;                    // while tracing
+};
+
+/**
+ * Builds the scene as elements stream past: every node is created in place
+ * in its parent's list, so no subtree is ever copied.
+ *
+ * <define name="..."> parses a group into the scene's prototypes; each
+ * <use ref="..."> then adds an instance group that holds only its own
+ * <transform> and points at the shared prototype.
+ */
+struct SceneBuilder : public XMLStreamHandler {
+    Scene& scene;
+    vector<ElementKind> kinds;
+    vector<OpenGroup> groups;
+    map<string, const Group*> prototypes;
+    string openDefine;  // <define> being parsed: published at its end tag, so it cannot use itself
+    bool hadPhysics;
+    bool hadPosition, hadLookAt, hadUp, hadProjection;  // <camera> children: only the first of each is used
+    int groupCount;
+    int instanceCount;
+    string error;
+
+    SceneBuilder(Scene& s) : scene(s), hadPhysics(false),
+        hadPosition(false), hadLookAt(false), hadUp(false), hadProjection(false), groupCount(0), instanceCount(0) {}
+
+    void fail(const string& message) {
+        if (error.empty()) error = message + " (line " + to_string(line) + ")";
+    }
+
+    void startElement(const char* name, const XMLStreamAttribute* a, int n) override {
+        ElementKind parent = kinds.empty() ? ELEMENT_IGNORED : kinds.back();
+        ElementKind kind = ELEMENT_IGNORED;
+
+        if (kinds.empty()) {
+            if (strcmp(name, "world") == 0) {
+                kind = ELEMENT_WORLD;
+            } else {
+                fail("No 'world' element found");
             }
-            child = child->NextSiblingElement();
-        }
-    }
-
-    // Parse models
-    XMLElement* modelsElem = groupElem->FirstChildElement("models");
-    if (modelsElem) {
-        XMLElement* modelElem = modelsElem->FirstChildElement("model");
-        while (modelElem) {
-            const char* file = modelElem->Attribute("file");
-            if (file) {
-                Model m;
-                m.file = file;
-                m.vertices = getModelVertices(file);
-                const char* col = modelElem->Attribute("color");
-                parseHexColor(col, m.r, m.g, m.b);
-                const char* cullAttr = modelElem->Attribute("cull");
-                if (cullAttr && strcmp(cullAttr, "false") == 0) {
-                    m.cull = false;
-                }
-                g.models.push_back(m);
+        } else if (parent == ELEMENT_WORLD) {
+            kind = worldChild(name, a, n);
+        } else if (parent == ELEMENT_CAMERA) {
+            cameraChild(name, a, n);
+        } else if (parent == ELEMENT_CAMERA_PATH && strcmp(name, "point") == 0) {
+            cameraPathPoint(a, n);
+        } else if (parent == ELEMENT_GROUP) {
+            kind = groupChild(name, a, n);
+        } else if (parent == ELEMENT_USE) {
+            OpenGroup& open = groups.back();
+            if (strcmp(name, "transform") == 0 && !open.hadTransform) {
+                open.hadTransform = true;
+                kind = ELEMENT_TRANSFORM;
             }
-            modelElem = modelElem->NextSiblingElement("model");
+        } else if (parent == ELEMENT_TRANSFORM) {
+            transformChild(name, a, n);
+        } else if (parent == ELEMENT_MODELS && strcmp(name, "model") == 0) {
+            model(a, n);
         }
+        kinds.push_back(kind);
     }
 
-    // Parse sub-groups
-    XMLElement* subGroupElem = groupElem->FirstChildElement("group");
-    while (subGroupElem) {
-        g.children.push_back(parseGroup(subGroupElem));
-        subGroupElem = subGroupElem->NextSiblingElement("group");
+    void endElement(const char*) override {
+        ElementKind kind = kinds.back();
+        kinds.pop_back();
+        if (kind == ELEMENT_GROUP || kind == ELEMENT_USE) {
+            if (traceEnabled()) {
+                string detail = "line " + to_string(groups.back().group->sourceLines.front());
+                traceComplete(kind == ELEMENT_GROUP ? "group" : "use", "config",
+                              groups.back().traceStartUs, detail.c_str());
+            }
+            if (groups.size() == 1 && groups.back().prototype) {
+                prototypes[openDefine] = groups.back().group;
+                openDefine.clear();
+            }
+            groups.pop_back();
+        } else if (kind == ELEMENT_CAMERA) {
+            Camera& camera = scene.camera;
+            float dx = camera.posX - camera.lookAtX;
+            float dy = camera.posY - camera.lookAtY;
+            float dz = camera.posZ - camera.lookAtZ;
+            camera.radius = sqrt(dx * dx + dy * dy + dz * dz);
+            camera.angleBeta = asin(dy / camera.radius) * 180.0f / M_PI;
+            camera.angleAlfa = atan2(dx, dz) * 180.0f / M_PI;
+        } else if (kind == ELEMENT_CAMERA_PATH) {
+            vector<CameraPathPoint>& points = scene.cameraPaths.back().points;
+            stable_sort(points.begin(), points.end(),
+                        [](const CameraPathPoint& p, const CameraPathPoint& q) { return p.time < q.time; });
+            if (points.empty()) scene.cameraPaths.pop_back();
+        }
     }
 
-    return g;
-}
+    ElementKind openGroup(Group& g, bool prototype) {
+        g.sourceLines.push_back(line);
+        OpenGroup open = { &g, prototype, false, false, false, traceEnabled() ? traceNowUs() : 0.0 };
+        groups.push_back(open);
+        groupCount++;
+        return ELEMENT_GROUP;
+    }
+
+    ElementKind define(const XMLStreamAttribute* a, int n) {
+        const char* name = findAttribute(a, n, "name");
+        if (!name) {
+            fail("<define> without a name");
+            return ELEMENT_IGNORED;
+        }
+        if (prototypes.count(name)) {
+            fail(string("Prototype '") + name + "' defined twice");
+            return ELEMENT_IGNORED;
+        }
+        scene.prototypes.emplace_back();
+        openDefine = name;
+        return openGroup(scene.prototypes.back(), true);
+    }
+
+    ElementKind use(Group& parent, bool prototype, const XMLStreamAttribute* a, int n) {
+        const char* ref = findAttribute(a, n, "ref");
+        if (ref && prototype && openDefine == ref) {
+            fail(string("Prototype '") + ref + "' used inside its own <define>");
+            return ELEMENT_IGNORED;
+        }
+        auto it = ref ? prototypes.find(ref) : prototypes.end();
+        if (it == prototypes.end()) {
+            fail(string("Unknown prototype '") + (ref ? ref : "") + "' (define it before use)");
+            return ELEMENT_IGNORED;
+        }
+        parent.children.emplace_back();
+        parent.children.back().instance = it->second;
+        openGroup(parent.children.back(), prototype);
+        instanceCount++;
+        return ELEMENT_USE;
+    }
+
+    ElementKind worldChild(const char* name, const XMLStreamAttribute* a, int n) {
+        if (strcmp(name, "group") == 0) {
+            scene.root.children.emplace_back();
+            return openGroup(scene.root.children.back(), false);
+        }
+        if (strcmp(name, "define") == 0) return define(a, n);
+        if (strcmp(name, "use") == 0) return use(scene.root, false, a, n);
+        if (strcmp(name, "window") == 0 && !scene.hasWindow) {
+            scene.hasWindow = true;
+            scene.windowWidth = intAttribute(a, n, "width", 800);
+            scene.windowHeight = intAttribute(a, n, "height", 600);
+        } else if (strcmp(name, "camera") == 0 && !scene.hasCamera) {
+            scene.hasCamera = true;
+            return ELEMENT_CAMERA;
+        } else if (strcmp(name, "cameraPath") == 0) {
+            const char* pathName = findAttribute(a, n, "name");
+            if (!pathName) {
+                cerr << "Warning: <cameraPath> without a name ignored" << endl;
+                return ELEMENT_IGNORED;
+            }
+            scene.cameraPaths.emplace_back();
+            scene.cameraPaths.back().name = pathName;
+            return ELEMENT_CAMERA_PATH;
+        } else if (strcmp(name, "physics") == 0 && !hadPhysics) {
+            hadPhysics = true;
+            PhysicsSettings& s = scene.physics.settings;
+            s.enabled = boolAttribute(a, n, "enabled", true);
+            const char* method = findAttribute(a, n, "method");
+            if (method && strcmp(method, "direct") == 0) {
+                s.method = FORCE_DIRECT;
+            }
+            s.G = floatAttribute(a, n, "G", s.G);
+            s.dt = floatAttribute(a, n, "dt", s.dt);
+            s.timeScale = floatAttribute(a, n, "timeScale", s.timeScale);
+            s.theta = floatAttribute(a, n, "theta", s.theta);
+            s.softening = floatAttribute(a, n, "softening", s.softening);
+            s.threads = intAttribute(a, n, "threads", s.threads);
+            s.maxSubsteps = intAttribute(a, n, "maxSubsteps", s.maxSubsteps);
+        }
+        return ELEMENT_IGNORED;
+    }
+
+    void cameraPathPoint(const XMLStreamAttribute* a, int n) {
+        CameraPathPoint p;
+        p.time = floatAttribute(a, n, "time", 0.0f);
+        p.x = floatAttribute(a, n, "x", 0.0f);
+        p.y = floatAttribute(a, n, "y", 0.0f);
+        p.z = floatAttribute(a, n, "z", 0.0f);
+        p.lookAtX = floatAttribute(a, n, "lookAtX", 0.0f);
+        p.lookAtY = floatAttribute(a, n, "lookAtY", 0.0f);
+        p.lookAtZ = floatAttribute(a, n, "lookAtZ", 0.0f);
+        scene.cameraPaths.back().points.push_back(p);
+    }
+
+    void cameraChild(const char* name, const XMLStreamAttribute* a, int n) {
+        Camera& camera = scene.camera;
+        if (strcmp(name, "position") == 0 && !hadPosition) {
+            hadPosition = true;
+            camera.posX = floatAttribute(a, n, "x", 10.0f);
+            camera.posY = floatAttribute(a, n, "y", 10.0f);
+            camera.posZ = floatAttribute(a, n, "z", 10.0f);
+        } else if (strcmp(name, "lookAt") == 0 && !hadLookAt) {
+            hadLookAt = true;
+            camera.lookAtX = floatAttribute(a, n, "x", 0.0f);
+            camera.lookAtY = floatAttribute(a, n, "y", 0.0f);
+            camera.lookAtZ = floatAttribute(a, n, "z", 0.0f);
+        } else if (strcmp(name, "up") == 0 && !hadUp) {
+            hadUp = true;
+            camera.upX = floatAttribute(a, n, "x", 0.0f);
+            camera.upY = floatAttribute(a, n, "y", 1.0f);
+            camera.upZ = floatAttribute(a, n, "z", 0.0f);
+        } else if (strcmp(name, "projection") == 0 && !hadProjection) {
+            hadProjection = true;
+            camera.fov = floatAttribute(a, n, "fov", 60.0f);
+            camera.nearPlane = floatAttribute(a, n, "near", 1.0f);
+            camera.farPlane = floatAttribute(a, n, "far", 1000.0f);
+        }
+    }
+
+    ElementKind groupChild(const char* name, const XMLStreamAttribute* a, int n) {
+        OpenGroup& open = groups.back();
+        if (strcmp(name, "group") == 0) {
+            open.group->children.emplace_back();
+            return openGroup(open.group->children.back(), open.prototype);
+        }
+        if (strcmp(name, "use") == 0) return use(*open.group, open.prototype, a, n);
+        if (strcmp(name, "transform") == 0 && !open.hadTransform) {
+            open.hadTransform = true;
+            return ELEMENT_TRANSFORM;
+        }
+        if (strcmp(name, "models") == 0 && !open.hadModels) {
+            open.hadModels = true;
+            return ELEMENT_MODELS;
+        }
+        if (strcmp(name, "body") == 0 && !open.hadBody) {
+            open.hadBody = true;
+            if (open.prototype) {
+                cerr << "Warning: <body> ignored inside <define> (instances would share it)" << endl;
+                return ELEMENT_IGNORED;
+            }
+            open.group->body = addBody(scene.physics,
+                                       floatAttribute(a, n, "mass", 1.0f),
+                                       floatAttribute(a, n, "vx", 0.0f),
+                                       floatAttribute(a, n, "vy", 0.0f),
+                                       floatAttribute(a, n, "vz", 0.0f));
+        }
+        return ELEMENT_IGNORED;
+    }
+
+    void transformChild(const char* name, const XMLStreamAttribute* a, int n) {
+        Transform t;
+        if (strcmp(name, "translate") == 0) {
+            t.type = TRANSLATE;
+            t.x = floatAttribute(a, n, "x", 0.0f);
+            t.y = floatAttribute(a, n, "y", 0.0f);
+            t.z = floatAttribute(a, n, "z", 0.0f);
+        } else if (strcmp(name, "rotate") == 0) {
+            t.type = ROTATE;
+            t.angle = floatAttribute(a, n, "angle", 0.0f);
+            t.x = floatAttribute(a, n, "x", 0.0f);
+            t.y = floatAttribute(a, n, "y", 0.0f);
+            t.z = floatAttribute(a, n, "z", 0.0f);
+        } else if (strcmp(name, "scale") == 0) {
+            t.type = SCALE;
+            t.x = floatAttribute(a, n, "x", 1.0f);
+            t.y = floatAttribute(a, n, "y", 1.0f);
+            t.z = floatAttribute(a, n, "z", 1.0f);
+        } else {
+            return;
+        }
+        groups.back().group->transforms.push_back(t);
+    }
+
+    void model(const XMLStreamAttribute* a, int n) {
+        const char* file = findAttribute(a, n, "file");
+        if (!file) return;
+        Group& g = *groups.back().group;
+        g.models.emplace_back();
+        Model& m = g.models.back();
+        m.file = file;
+        m.mesh = getModelVertices(file);
+        parseHexColor(findAttribute(a, n, "color"), m.r, m.g, m.b);
+        const char* cullAttr = findAttribute(a, n, "cull");
+        if (cullAttr && strcmp(cullAttr, "false") == 0) {
+            m.cull = false;
+        }
+    }
+};
 
 // ============================================================================
 // CONFIG LOADING
 // ============================================================================
 
-void loadConfigs(const char* filename) {
-    XMLDocument doc;
+static bool loadXMLScene(const char* filename, Scene& scene) {
+    TraceScope trace("parseConfig", "config", filename);
+    auto start = chrono::steady_clock::now();
+    SceneBuilder builder(scene);
+    string error;
+    bool ok = streamXMLFile(filename, builder, error);
+    if (ok && !builder.error.empty()) {
+        ok = false;
+        error = builder.error;
+    }
+    if (!ok) {
+        cerr << "Error loading XML file " << filename << ": " << error << endl;
+        scene.root.children.clear();
+        scene.prototypes.clear();
+        scene.physics.bodies.clear();
+        return false;
+    }
+    scene.file = filename;
 
-    if (doc.LoadFile(filename) != XML_SUCCESS) {
-        cerr << "Error loading XML file: " << filename << endl;
-        return;
+    // Bodies start at the world-space origin of their group
+    placeBodies(scene.physics, scene.root);
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Configuration loaded successfully! (" << builder.groupCount << " groups";
+    if (!scene.prototypes.empty()) {
+        cout << ", " << builder.instanceCount << " instances of "
+             << scene.prototypes.size() << " prototypes";
     }
+    cout << " in " << ms << " ms, peak memory " << peakMemoryMB() << " MB; scene graph: "
+         << scene.arena.allocations << " allocations, "
+         << scene.arena.bytes / 1024.0 << " KB in "
+         << scene.arena.upstream.blocks << " heap blocks)" << endl;
+    return true;
+}
 
-    XMLElement* root = doc.FirstChildElement("world");
-    if (!root) {
-        cerr << "Error: No 'world' element found" << endl;
-        return;
+/**
+ * Whether every group's body index is one of the scene's bodies, so the
+ * renderer can index them without checking
+ */
+static bool bodiesInRange(const Group& g, size_t bodyCount) {
+    if (g.body >= 0 && (size_t)g.body >= bodyCount) return false;
+    for (const auto& child : g.children) {
+        if (!bodiesInRange(child, bodyCount)) return false;
     }
+    return true;
+}
 
-    // Window
-    XMLElement* window = root->FirstChildElement("window");
-    if (window) {
-        extern int windowWidth;
-        extern int windowHeight;
-        windowWidth = window->IntAttribute("width", 800);
-        windowHeight = window->IntAttribute("height", 600);
-    }
-
-    // Camera
-    XMLElement* cameraElem = root->FirstChildElement("camera");
-    if (cameraElem) {
-        extern Camera camera;
-        XMLElement* pos = cameraElem->FirstChildElement("position");
-        if (pos) {
-            camera.posX = pos->FloatAttribute("x", 10.0f);
-            camera.posY = pos->FloatAttribute("y", 10.0f);
-            camera.posZ = pos->FloatAttribute("z", 10.0f);
-        }
-        XMLElement* lookAt = cameraElem->FirstChildElement("lookAt");
-        if (lookAt) {
-            camera.lookAtX = lookAt->FloatAttribute("x", 0.0f);
-            camera.lookAtY = lookAt->FloatAttribute("y", 0.0f);
-            camera.lookAtZ = lookAt->FloatAttribute("z", 0.0f);
-        }
-        XMLElement* up = cameraElem->FirstChildElement("up");
-        if (up) {
-            camera.upX = up->FloatAttribute("x", 0.0f);
-            camera.upY = up->FloatAttribute("y", 1.0f);
-            camera.upZ = up->FloatAttribute("z", 0.0f);
-        }
-        XMLElement* proj = cameraElem->FirstChildElement("projection");
-        if (proj) {
-            camera.fov = proj->FloatAttribute("fov", 60.0f);
-            camera.nearPlane = proj->FloatAttribute("near", 1.0f);
-            camera.farPlane = proj->FloatAttribute("far", 1000.0f);
-        }
-
-        float dx = camera.posX - camera.lookAtX;
-        float dy = camera.posY - camera.lookAtY;
-        float dz = camera.posZ - camera.lookAtZ;
-        camera.radius = sqrt(dx * dx + dy * dy + dz * dz);
-        camera.angleBeta = asin(dy / camera.radius) * 180.0f / M_PI;
-        camera.angleAlfa = atan2(dx, dz) * 180.0f / M_PI;
-    }
-
-    // Root groups
-    XMLElement* groupElem = root->FirstChildElement("group");
-    while (groupElem) {
-        rootGroup.children.push_back(parseGroup(groupElem));
-        groupElem = groupElem->NextSiblingElement("group");
-    }
-
-    cout << "Configuration loaded successfully!" << endl;
+bool loadScene(const char* filename, Scene& scene) {
+    TraceScope trace("loadScene", "config", filename);
+    resetMemoryMarks();
+    markMemory("start");
+    bool snapshot = isSnapshotFile(filename);
+    bool ok = snapshot ? loadSnapshot(filename, scene) : loadXMLScene(filename, scene);
+    markMemory(snapshot ? "mapped" : "parsed");
+    if (ok) {
+        size_t bodyCount = scene.physics.bodies.size();
+        bool inRange = bodiesInRange(scene.root, bodyCount);
+        for (const auto& prototype : scene.prototypes) {
+            inRange = inRange && bodiesInRange(prototype, bodyCount);
+        }
+        if (!inRange) {
+            cerr << "Error loading " << filename << ": a group refers to a body the scene does not have" << endl;
+            scene.root.children.clear();
+            scene.prototypes.clear();
+            scene.physics.bodies.clear();
+            ok = false;
+        }
+    }
+    if (ok && optimizeScenes) {
+        optimizeScene(scene);
+        markMemory("optimized");
+    }
+    return ok;
 }
 
-void reloadConfig() {
-    rootGroup = Group();
-    clearModelCache();
-    loadConfigs(currentConfigFile.c_str());
-    cout << "Configuration reloaded!" << endl;
-    glutPostRedisplay();
+void applyScene(const shared_ptr<Scene>& scene) {
+    extern int windowWidth;
+    extern int windowHeight;
+    extern Camera camera;
+
+    activeScene = scene;
+    if (scene->hasWindow) {
+        windowWidth = scene->windowWidth;
+        windowHeight = scene->windowHeight;
+    }
+    if (scene->hasCamera) {
+        camera = scene->camera;
+    }
+}
+
+void loadConfigs(const char* filename) {
+    shared_ptr<Scene> scene = make_shared<Scene>();
+    loadScene(filename, *scene);
+    applyScene(scene);
+    markMemory("applied");
 }
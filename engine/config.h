@@ -2,17 +2,15 @@
 #define CONFIG_H
 
 #include <string>
-#include <tinyxml2.h>
 #include "geometry.h"
+#include "scene.h"
 
 using namespace std;
-using namespace tinyxml2;
 
 // ============================================================================
 // CONFIGURATION MANAGEMENT
 // ============================================================================
 
-extern Group rootGroup;
 extern string currentConfigFile;
 
 /**
@@ -21,18 +19,20 @@ extern string currentConfigFile;
 void parseHexColor(const char* hex, float& r, float& g, float& b);
 
 /**
- * Parse a group element from XML recursively
+ * Load an XML configuration file (streamed, without a document tree) or a
+ * scenec snapshot into a new scene and optimize its graph (no global state
+ * touched, safe to run on a background thread)
  */
-Group parseGroup(XMLElement* groupElem);
+bool loadScene(const char* filename, Scene& scene);
 
 /**
- * Load XML configuration file
+ * Make a loaded scene the active one and apply its window/camera settings
  */
-void loadConfigs(const char* filename);
+void applyScene(const shared_ptr<Scene>& scene);
 
 /**
- * Reload the current configuration
+ * Load XML configuration file and make it the active scene
  */
-void reloadConfig();
+void loadConfigs(const char* filename);
 
 #endif // CONFIG_H
@@ -5,19 +5,39 @@
 // Rendering logic: rendering.cpp
 // Input handling:  input.cpp
 // Configuration:   config.cpp
+// Hot reload:      reload.cpp
+// File watching:   watcher.cpp
 // Model loading:   model.cpp
+// Snapshots:       snapshot.cpp (written by scenec.cpp)
 // Data structures: geometry.h
 // Menu interface:  menu.cpp
+// Frame pacing:    scheduler.cpp
+// Benchmarking:    bench.cpp (headless, EGL)
+// Live stats:      statsserver.cpp (Unix socket)
 // ============================================================================
 
 #include <iostream>
 #include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
 #include "geometry.h"
 #include "rendering.h"
 #include "config.h"
 #include "input.h"
 #include "model.h"
 #include "menu.h"
+#include "scheduler.h"
+#include "scene.h"
+#include "watcher.h"
+#include "optimize.h"
+#include "bench.h"
+#include "profiler.h"
+#include "memory.h"
+#include "camerapath.h"
+#include "statsserver.h"
+#include "analysis.h"
+#include "../include/trace.h"
 
 #ifdef __APPLE__
 #include <GLUT/glut.h>
@@ -47,26 +67,118 @@ Camera camera;
 bool freeCamera = false;
 
 // Scene graph and configuration
-Group rootGroup;
+shared_ptr<Scene> activeScene = make_shared<Scene>();
 
 // ============================================================================
 // MAIN APPLICATION
 // ============================================================================
 
+void printUsage(const char* program) {
+    cerr << "Usage: " << program << " [options] <config.xml | scene.snap>" << endl;
+    cerr << "Options:" << endl;
+    cerr << "  --frames <on-demand|capped|uncapped>  Frame scheduling (default: on-demand)" << endl;
+    cerr << "  --fps <n>                             Target FPS for capped mode and animation (default: 60)" << endl;
+    cerr << "  --watch                               Reload incrementally when the config or its figures change" << endl;
+    cerr << "  --no-optimize                         Keep the scene graph exactly as written in the config" << endl;
+    cerr << "  --dump-graph                          Print the loaded scene graph with its config line numbers" << endl;
+    cerr << "  --memory-report                       Print where the loaded scene's memory goes (also key U)" << endl;
+    cerr << "  --trace <file>                        Write a Chrome trace of loading and frames at exit (or set TRACE_FILE)" << endl;
+    cerr << "  --frame-csv <file>                    Write per-phase timings and counters of every frame to a CSV file" << endl;
+    cerr << "  --record <file>                       Record the camera and keys of every frame (fixed animation step)" << endl;
+    cerr << "  --replay <file | path>                Replay a recording or a <cameraPath> of the config, print frame times and exit" << endl;
+    cerr << "  --view <normal|overdraw|triangles|density>  Start in a cost analysis view (key X cycles, key Z prints a report)" << endl;
+    cerr << "  --stats-socket <path>                 Serve live stats (JSON, Prometheus) and reload/memory commands on a Unix socket" << endl;
+    cerr << "  --bench                               Render offscreen without a window, print a JSON report and exit" << endl;
+    cerr << "  --bench-warmup <n>                    Frames drawn before timing starts (default: 60)" << endl;
+    cerr << "  --bench-frames <n>                    Frames timed for the report (default: 600)" << endl;
+    cerr << "  --bench-out <file>                    Write the report to a file instead of stdout" << endl;
+}
+
 int main(int argc, char **argv) {
-    if (argc < 2) {
-        cerr << "Usage: " << argv[0] << " <config.xml>" << endl;
+    traceStartFromEnvironment();
+    const char* configArg = NULL;
+    bool dumpGraph = false;
+    bool memoryReport = false;
+    const char* recordFile = NULL;
+    const char* replaySource = NULL;
+    const char* statsSocket = NULL;
+    bool bench = false;
+    BenchOptions benchOptions;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            if (!parseFrameMode(argv[++i], frameMode)) {
+                cerr << "Unknown frame mode: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            targetFPS = atof(argv[++i]);
+            if (targetFPS <= 0.0f) targetFPS = 60.0f;
+        } else if (strcmp(argv[i], "--watch") == 0) {
+            watchFiles = true;
+        } else if (strcmp(argv[i], "--no-optimize") == 0) {
+            optimizeScenes = false;
+        } else if (strcmp(argv[i], "--dump-graph") == 0) {
+            dumpGraph = true;
+        } else if (strcmp(argv[i], "--memory-report") == 0) {
+            memoryReport = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceStart(argv[++i]);
+        } else if (strcmp(argv[i], "--frame-csv") == 0 && i + 1 < argc) {
+            if (!openFrameCSV(argv[++i])) return 1;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordFile = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replaySource = argv[++i];
+        } else if (strcmp(argv[i], "--view") == 0 && i + 1 < argc) {
+            if (!parseAnalysisView(argv[++i], analysisView)) {
+                cerr << "Unknown view: " << argv[i] << endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--stats-socket") == 0 && i + 1 < argc) {
+            statsSocket = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (strcmp(argv[i], "--bench-warmup") == 0 && i + 1 < argc) {
+            benchOptions.warmupFrames = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--bench-frames") == 0 && i + 1 < argc) {
+            benchOptions.measuredFrames = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--bench-out") == 0 && i + 1 < argc) {
+            benchOptions.output = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            cerr << "Unknown option: " << argv[i] << endl;
+            printUsage(argv[0]);
+            return 1;
+        } else if (!configArg) {
+            configArg = argv[i];
+        }
+    }
+    if (!configArg) {
+        printUsage(argv[0]);
         return 1;
     }
 
     // Load configuration
     string configPath = "../../configs/";
-    currentConfigFile = configPath + argv[1];
+    currentConfigFile = configPath + configArg;
+    benchOptions.memoryReport = memoryReport;
+    if (replaySource) benchOptions.replay = replaySource;
+    if (statsSocket) benchOptions.statsSocket = statsSocket;
+    if (bench) return runBenchmark(currentConfigFile.c_str(), benchOptions);
     loadConfigs(currentConfigFile.c_str());
+    if (dumpGraph) dumpSceneGraph(*activeScene, cout);
+    if (memoryReport) printMemoryReport(*activeScene, cout);
+
+    // Recording and replay need a frame every refresh and a fixed animation step
+    if (recordFile || replaySource) {
+        if (frameMode == FRAME_ON_DEMAND) frameMode = FRAME_CAPPED;
+        setFixedFrameStep(1000.0 / targetFPS);
+    }
+    if (recordFile && !startCameraRecording(recordFile, 1000.0 / targetFPS)) return 1;
+    if (replaySource && !startCameraReplay(replaySource, *activeScene, 1000.0 / targetFPS)) return 1;
 
     // Initialize GLUT
     glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA);
+    glutInitDisplayMode(GLUT_DEPTH | GLUT_STENCIL | GLUT_DOUBLE | GLUT_RGBA);
     glutInitWindowPosition(100, 100);
     glutInitWindowSize(windowWidth, windowHeight);
     glutCreateWindow("SolariUM - Phase 2");
@@ -77,17 +189,13 @@ int main(int argc, char **argv) {
     glutKeyboardFunc(processKeys);
     glutMouseFunc(processMouseButtons);
     glutMotionFunc(processMouseMotion);
-    // keep rendering continuously so FPS counter updates even when idle
-    glutIdleFunc(renderScene);
+    // Frames are drawn on demand / paced by the scheduler instead of an idle spin
+    initScheduler();
+    if (watchFiles) startWatching();
+    if (statsSocket && !startStatsServer(statsSocket)) return 1;
 
     // OpenGL setup
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    glClearColor(0.02f, 0.02f, 0.08f, 1.0f);
-
-
+    setupGL();
 
     // Display menu
     displayMenu();
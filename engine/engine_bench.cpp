@@ -0,0 +1,341 @@
+// ============================================================================
+// ENGINE MICRO-BENCHMARKS
+// ============================================================================
+// Times the engine's hot paths one at a time, without GL: .3d parsing per
+// file size, config loading (streaming parse alone and with the optimizer)
+// on a small and a huge config, the model cache hit and miss paths,
+// transform composition and a world-matrix walk of the scene graph.
+// Inputs are generated into a temporary directory laid out like the repo
+// (figures/, configs/, build dir two levels down), so nothing in the tree
+// is read or written.
+//
+// Usage: engine_bench [--benchmark_filter=<regex>] [--benchmark_repetitions=<n>]
+//                     [--benchmark_out=<file.json> --benchmark_out_format=json]
+// ============================================================================
+
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "config.h"
+#include "model.h"
+#include "matrix.h"
+#include "optimize.h"
+
+using namespace std;
+
+// config.cpp's applyScene refers to the engine's globals
+shared_ptr<Scene> activeScene;
+int windowWidth = 800;
+int windowHeight = 600;
+Camera camera;
+
+// Vertex counts of the generated .3d files
+static const int MESH_SIZES[] = { 1 << 10, 1 << 14, 1 << 17 };
+
+// Group counts of the generated configs
+static const int SMALL_GROUPS = 16;
+static const int HUGE_GROUPS = 20000;
+
+static string benchRoot;
+
+// ============================================================================
+// INPUTS
+// ============================================================================
+
+static string meshFile(int vertices) {
+    return "bench_" + to_string(vertices) + ".3d";
+}
+
+static string configPath(int groups) {
+    return "../../configs/bench_" + to_string(groups) + ".xml";
+}
+
+/**
+ * Write a .3d file of random triangles in the generator's format
+ */
+static void writeMesh(int vertices) {
+    ofstream out(benchRoot + "/figures/" + meshFile(vertices));
+    mt19937 rng(vertices);
+    uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    out << vertices << "\n";
+    for (int i = 0; i < vertices; i++) {
+        out << unit(rng) << " " << unit(rng) << " " << unit(rng) << "\n";
+    }
+}
+
+/**
+ * Write a config of `groups` groups, eight children per group, each with a
+ * translate/rotate/scale and a model (the meshes are shared, so the cost is
+ * the XML and the graph rather than the .3d files)
+ */
+static void writeConfig(int groups) {
+    ofstream out(benchRoot + "/configs/bench_" + to_string(groups) + ".xml");
+    mt19937 rng(groups);
+    uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    // children[i] of group i, filled breadth-first
+    vector<vector<int>> children(groups);
+    vector<int> roots;
+    for (int i = 0; i < groups; i++) {
+        if (i < 8) roots.push_back(i);
+        else children[(i - 8) / 8].push_back(i);
+    }
+
+    out << "<world>\n";
+    out << "    <camera>\n";
+    out << "        <position x=\"0\" y=\"50\" z=\"100\" />\n";
+    out << "        <lookAt x=\"0\" y=\"0\" z=\"0\" />\n";
+    out << "        <up x=\"0\" y=\"1\" z=\"0\" />\n";
+    out << "        <projection fov=\"60\" near=\"1\" far=\"1000\" />\n";
+    out << "    </camera>\n";
+
+    // Depth-first with an explicit stack (the tree is too wide for recursion to matter,
+    // but this keeps the writer independent of depth)
+    vector<pair<int, bool>> stack;
+    for (auto it = roots.rbegin(); it != roots.rend(); ++it) stack.push_back({ *it, false });
+    int depth = 1;
+    while (!stack.empty()) {
+        pair<int, bool> top = stack.back();
+        stack.pop_back();
+        if (top.second) {
+            depth--;
+            out << string(depth * 4, ' ') << "</group>\n";
+            continue;
+        }
+        int i = top.first;
+        string indent(depth * 4, ' ');
+        out << indent << "<group>\n";
+        out << indent << "    <transform>\n";
+        out << indent << "        <translate x=\"" << unit(rng) * 10.0f << "\" y=\"" << unit(rng)
+            << "\" z=\"" << unit(rng) * 10.0f << "\" />\n";
+        out << indent << "        <rotate angle=\"" << unit(rng) * 180.0f << "\" x=\"0\" y=\"1\" z=\"0\" />\n";
+        out << indent << "        <scale x=\"0.5\" y=\"0.5\" z=\"0.5\" />\n";
+        out << indent << "    </transform>\n";
+        out << indent << "    <models>\n";
+        out << indent << "        <model file=\"" << meshFile(MESH_SIZES[0]) << "\" color=\"#"
+            << hex << (0x404040 + i * 0x2F1B07 % 0xBFBFBF) << dec << "\" />\n";
+        out << indent << "    </models>\n";
+        stack.push_back({ i, true });
+        for (auto it = children[i].rbegin(); it != children[i].rend(); ++it) stack.push_back({ *it, false });
+        depth++;
+    }
+    out << "</world>\n";
+}
+
+static bool makeBenchTree() {
+    char root[] = "/tmp/engine_bench.XXXXXX";
+    if (!mkdtemp(root)) return false;
+    benchRoot = root;
+    mkdir((benchRoot + "/figures").c_str(), 0755);
+    mkdir((benchRoot + "/configs").c_str(), 0755);
+    mkdir((benchRoot + "/build").c_str(), 0755);
+    mkdir((benchRoot + "/build/bench").c_str(), 0755);
+
+    for (int vertices : MESH_SIZES) writeMesh(vertices);
+    writeConfig(SMALL_GROUPS);
+    writeConfig(HUGE_GROUPS);
+    // Relative figure and config paths resolve like they do from engine/build
+    return chdir((benchRoot + "/build/bench").c_str()) == 0;
+}
+
+static void removeBenchTree() {
+    if (chdir("/") != 0) return;
+    string command = "rm -rf '" + benchRoot + "'";
+    if (system(command.c_str()) != 0) {
+        cerr << "Could not remove " << benchRoot << endl;
+    }
+}
+
+/**
+ * Silences cout for a scope (the optimizer prints a report per load)
+ */
+struct QuietOutput {
+    ostringstream sink;
+    streambuf* saved;
+    QuietOutput() : saved(cout.rdbuf(sink.rdbuf())) {}
+    ~QuietOutput() { cout.rdbuf(saved); }
+};
+
+// ============================================================================
+// MODELS
+// ============================================================================
+
+static void BM_LoadModelFile(benchmark::State& state) {
+    int vertices = state.range(0);
+    string path = modelFilePath(meshFile(vertices));
+    struct stat info;
+    stat(path.c_str(), &info);
+    for (auto _ : state) {
+        shared_ptr<Mesh> mesh = loadModelFile(path.c_str());
+        benchmark::DoNotOptimize(mesh->vertices);
+    }
+    state.SetBytesProcessed(state.iterations() * info.st_size);
+    state.SetItemsProcessed(state.iterations() * vertices);
+}
+BENCHMARK(BM_LoadModelFile)->Arg(MESH_SIZES[0])->Arg(MESH_SIZES[1])->Arg(MESH_SIZES[2])
+    ->Unit(benchmark::kMicrosecond);
+
+// Cached mesh, unchanged on disk: the cost is the lookup and the stat
+static void BM_GetModelVerticesHit(benchmark::State& state) {
+    string file = meshFile(MESH_SIZES[0]);
+    clearModelCache();
+    MeshPtr held = getModelVertices(file);
+    for (auto _ : state) {
+        MeshPtr mesh = getModelVertices(file);
+        benchmark::DoNotOptimize(mesh.get());
+    }
+}
+BENCHMARK(BM_GetModelVerticesHit);
+
+// Empty cache: every call reads the file
+static void BM_GetModelVerticesMiss(benchmark::State& state) {
+    string file = meshFile(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        clearModelCache();
+        state.ResumeTiming();
+        MeshPtr mesh = getModelVertices(file);
+        benchmark::DoNotOptimize(mesh.get());
+    }
+    clearModelCache();
+}
+BENCHMARK(BM_GetModelVerticesMiss)->Arg(MESH_SIZES[0])->Arg(MESH_SIZES[1])
+    ->Unit(benchmark::kMicrosecond);
+
+// ============================================================================
+// CONFIGS
+// ============================================================================
+
+/**
+ * loadScene on a config of range(0) groups; range(1) turns the optimizer on
+ * (meshes stay cached between iterations, as on a reload)
+ */
+static void BM_LoadScene(benchmark::State& state) {
+    int groups = state.range(0);
+    string path = configPath(groups);
+    bool savedOptimize = optimizeScenes;
+    optimizeScenes = state.range(1) != 0;
+    QuietOutput quiet;
+    for (auto _ : state) {
+        Scene scene;
+        if (!loadScene(path.c_str(), scene)) {
+            state.SkipWithError("config failed to load");
+            break;
+        }
+        benchmark::DoNotOptimize(scene.root.children.size());
+    }
+    optimizeScenes = savedOptimize;
+    state.SetItemsProcessed(state.iterations() * groups);
+}
+BENCHMARK(BM_LoadScene)->ArgNames({ "groups", "optimize" })
+    ->Args({ SMALL_GROUPS, 0 })->Args({ SMALL_GROUPS, 1 })
+    ->Args({ HUGE_GROUPS, 0 })->Args({ HUGE_GROUPS, 1 })
+    ->Unit(benchmark::kMillisecond);
+
+// loadConfigs also swaps the active scene and releases the previous one
+static void BM_LoadConfigs(benchmark::State& state) {
+    string path = configPath(state.range(0));
+    QuietOutput quiet;
+    for (auto _ : state) {
+        loadConfigs(path.c_str());
+        benchmark::DoNotOptimize(activeScene.get());
+    }
+    activeScene.reset();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadConfigs)->Arg(SMALL_GROUPS)->Arg(HUGE_GROUPS)->Unit(benchmark::kMillisecond);
+
+// ============================================================================
+// TRANSFORMS AND TRAVERSAL
+// ============================================================================
+
+// One group's translate/rotate/scale applied to a matrix
+static void BM_TransformCompose(benchmark::State& state) {
+    Transform transforms[3] = {
+        { TRANSLATE, 1.0f, 2.0f, 3.0f, 0.0f },
+        { ROTATE, 0.0f, 1.0f, 0.0f, 30.0f },
+        { SCALE, 0.5f, 0.5f, 0.5f, 0.0f },
+    };
+    for (auto _ : state) {
+        Mat4 mat;
+        for (const auto& t : transforms) mat4Apply(mat, t);
+        benchmark::DoNotOptimize(mat.m);
+    }
+    state.SetItemsProcessed(state.iterations() * 3);
+}
+BENCHMARK(BM_TransformCompose);
+
+static void BM_Mat4Multiply(benchmark::State& state) {
+    Mat4 a = mat4FromTransform({ ROTATE, 0.0f, 1.0f, 0.0f, 30.0f });
+    Mat4 b = mat4FromTransform({ TRANSLATE, 1.0f, 2.0f, 3.0f, 0.0f });
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(a.m);
+        Mat4 c = mat4Multiply(a, b);
+        benchmark::DoNotOptimize(c.m);
+    }
+}
+BENCHMARK(BM_Mat4Multiply);
+
+/**
+ * World matrix of every group, the way the renderer walks the graph but
+ * with matrix math in place of GL calls; returns a checksum
+ */
+static float walkGroup(const Group& g, const Mat4& parent) {
+    Mat4 world = g.hasMatrix ? mat4Multiply(parent, g.matrix) : parent;
+    for (const auto& t : g.transforms) mat4Apply(world, t);
+    float sum = g.models.empty() ? 0.0f : world.m[12];
+    for (const auto& child : g.children) sum += walkGroup(child, world);
+    if (g.instance) sum += walkGroup(*g.instance, world);
+    return sum;
+}
+
+static void BM_SceneTraversal(benchmark::State& state) {
+    bool savedOptimize = optimizeScenes;
+    optimizeScenes = state.range(0) != 0;
+    Scene scene;
+    {
+        QuietOutput quiet;
+        loadScene(configPath(HUGE_GROUPS).c_str(), scene);
+    }
+    optimizeScenes = savedOptimize;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(walkGroup(scene.root, Mat4()));
+    }
+    state.SetItemsProcessed(state.iterations() * HUGE_GROUPS);
+}
+BENCHMARK(BM_SceneTraversal)->ArgName("optimize")->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+// The optimizer's cost estimate: a read-only walk with no matrix math
+static void BM_MeasureSceneGraph(benchmark::State& state) {
+    Scene scene;
+    {
+        QuietOutput quiet;
+        loadScene(configPath(HUGE_GROUPS).c_str(), scene);
+    }
+    for (auto _ : state) {
+        GraphCost cost = measureSceneGraph(scene, false);
+        benchmark::DoNotOptimize(cost.visits);
+    }
+    state.SetItemsProcessed(state.iterations() * HUGE_GROUPS);
+}
+BENCHMARK(BM_MeasureSceneGraph)->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    if (!makeBenchTree()) {
+        cerr << "Could not create the benchmark inputs under /tmp" << endl;
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    removeBenchTree();
+    return 0;
+}
@@ -5,6 +5,8 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <memory>
+#include <memory_resource>
 
 using namespace std;
 
@@ -24,18 +26,61 @@ struct Transform {
     float angle;   // Static angle for ROTATE
 };
 
+// Column-major 4x4 matrix, same layout as OpenGL (operations in matrix.h)
+struct Mat4 {
+    float m[16];
+    Mat4();   // identity
+};
+
+// Vertex data of one .3d file, shared by every model that uses it. The
+// triangle list is one contiguous array: either owned (storage) or mapped
+// straight from a scene snapshot, in which case owner keeps the mapping alive.
+struct Mesh {
+    string file;
+    const Vertex* vertices;
+    size_t vertexCount;
+    vector<Vertex> storage;
+    shared_ptr<const void> owner;
+    Mesh() : vertices(nullptr), vertexCount(0) {}
+};
+
 struct Model {
     string file;
-    list<Vertex> vertices;
+    shared_ptr<const Mesh> mesh;
     float r, g, b; // display color (default white)
     bool cull;     // enable backface culling (default true)
     Model() : r(1.0f), g(1.0f), b(1.0f), cull(true) {}
 };
 
+// Scene graph node. Allocator-aware so a whole tree can live in its scene's
+// arena: nested groups inherit the allocator of the list they are put in.
 struct Group {
-    list<Transform> transforms;
-    list<Model> models;
-    list<Group> children;
+    typedef pmr::polymorphic_allocator<char> allocator_type;
+
+    pmr::list<Transform> transforms;
+    pmr::list<Model> models;
+    pmr::list<Group> children;
+    int body = -1; // index into the scene's physics bodies (-1 = static group)
+    const Group* instance = nullptr; // shared prototype drawn after the children (<use>)
+    bool hasMatrix = false;          // transforms precomputed into matrix (snapshots, optimizer)
+    Mat4 matrix;
+    pmr::vector<int> sourceLines;    // config lines of the elements merged into this group
+
+    Group() {}
+    explicit Group(const allocator_type& alloc) :
+        transforms(alloc), models(alloc), children(alloc), sourceLines(alloc) {}
+    Group(const Group& other, const allocator_type& alloc) :
+        transforms(other.transforms, alloc), models(other.models, alloc),
+        children(other.children, alloc), body(other.body), instance(other.instance),
+        hasMatrix(other.hasMatrix), matrix(other.matrix), sourceLines(other.sourceLines, alloc) {}
+    Group(Group&& other, const allocator_type& alloc) :
+        transforms(move(other.transforms), alloc), models(move(other.models), alloc),
+        children(move(other.children), alloc), body(other.body), instance(other.instance),
+        hasMatrix(other.hasMatrix), matrix(other.matrix), sourceLines(move(other.sourceLines), alloc) {}
+    Group(const Group&) = default;
+    Group(Group&&) = default;
+    Group& operator=(const Group&) = default;
+    Group& operator=(Group&&) = default;
 };
 
 // ============================================================================
@@ -67,4 +112,17 @@ struct Camera {
         velocity(5.0f) {}
 };
 
+// Camera fly-through authored in a config (<cameraPath>): the position is
+// interpolated through the points, the look-at target linearly
+struct CameraPathPoint {
+    float time;  // seconds from the start of the path
+    float x, y, z;
+    float lookAtX, lookAtY, lookAtZ;
+};
+
+struct CameraPath {
+    string name;
+    vector<CameraPathPoint> points;  // sorted by time
+};
+
 #endif // GEOMETRY_H
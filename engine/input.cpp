@@ -1,6 +1,10 @@
 #include "input.h"
-#include "config.h"
+#include "reload.h"
 #include "menu.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "camerapath.h"
+#include "analysis.h"
 #include <cmath>
 
 #ifdef __APPLE__
@@ -79,6 +83,7 @@ void rotateCameraPitch(float angle) {
 // ============================================================================
 
 void processKeys(unsigned char c, int xx, int yy) {
+    recordCameraKey(c);
     float zoomStep = camera.radius * 0.05f;
     if (zoomStep < 1.0f) zoomStep = 1.0f;
     switch (c) {
@@ -88,22 +93,29 @@ void processKeys(unsigned char c, int xx, int yy) {
         case 'l': camera.angleAlfa += 5.0f; break;
         case '+': if (freeCamera) camera.velocity *= 1.1f; else { camera.radius -= zoomStep; if (camera.radius < 1.0f) camera.radius = 1.0f; } break;
         case '-': if (freeCamera) camera.velocity *= 0.9f; else camera.radius += zoomStep; break;
-        case 'w': case 'W': if (!freeCamera) toggleWireframe(); else moveCameraForward(1.0f); glutPostRedisplay(); break;
-        case 's': case 'S': if (freeCamera) { moveCameraBackward(1.0f); glutPostRedisplay(); } break;
-        case 'a': case 'A': if (!freeCamera) toggleShowAxes(); else { moveCameraLeft(1.0f); glutPostRedisplay(); } break;
-        case 'd': case 'D': if (freeCamera) { moveCameraRight(1.0f); glutPostRedisplay(); } break;
+        case 'w': case 'W': if (!freeCamera) toggleWireframe(); else moveCameraForward(1.0f); requestRedraw(); break;
+        case 's': case 'S': if (freeCamera) { moveCameraBackward(1.0f); requestRedraw(); } break;
+        case 'a': case 'A': if (!freeCamera) toggleShowAxes(); else { moveCameraLeft(1.0f); requestRedraw(); } break;
+        case 'd': case 'D': if (freeCamera) { moveCameraRight(1.0f); requestRedraw(); } break;
         case 'f': case 'F': freeCamera = !freeCamera; if (freeCamera) { 
             // Initialize forward towards negative Z
             camera.forwardX = 0.0f; camera.forwardY = 0.0f; camera.forwardZ = -1.0f;
             camera.rightX = 1.0f; camera.rightY = 0.0f; camera.rightZ = 0.0f;
-        } glutPostRedisplay(); break;
+        } requestRedraw(); break;
         case 'c': case 'C': toggleCulling(); break;
         case 'o': case 'O': toggleShowFPS(); break;
+        case 't': case 'T': toggleFrameStats(); break;
         case 'm': case 'M': displayMenu(); break;
+        case 'p': case 'P': togglePhysicsPaused(); break;
+        case 'g': case 'G': toggleForceMethod(); break;
+        case 'v': case 'V': toggleFrameMode(); break;
         case 'r': case 'R': reloadConfig(); break;
+        case 'u': case 'U': showMemoryReport(); break;
+        case 'x': case 'X': cycleAnalysisView(); break;
+        case 'z': case 'Z': requestCostReport(); break;
         case 27: exit(0); break;
     }
-    glutPostRedisplay();
+    requestRedraw();
 }
 
 // ============================================================================
@@ -119,8 +131,8 @@ void processMouseButtons(int button, int state, int x, int y) {
     if (!freeCamera) {
         float zoomStep = camera.radius * 0.05f;
         if (zoomStep < 1.0f) zoomStep = 1.0f;
-        if (button == 3) { camera.radius -= zoomStep; if (camera.radius < 1.0f) camera.radius = 1.0f; glutPostRedisplay(); }
-        if (button == 4) { camera.radius += zoomStep; glutPostRedisplay(); }
+        if (button == 3) { camera.radius -= zoomStep; if (camera.radius < 1.0f) camera.radius = 1.0f; requestRedraw(); }
+        if (button == 4) { camera.radius += zoomStep; requestRedraw(); }
     }
 }
 
@@ -137,6 +149,6 @@ void processMouseMotion(int x, int y) {
             rotateCameraPitch((y - mouseY) * 0.1f);
         }
         mouseX = x; mouseY = y;
-        glutPostRedisplay();
+        requestRedraw();
     }
 }
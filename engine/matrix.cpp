@@ -0,0 +1,72 @@
+#include "matrix.h"
+#include <cmath>
+
+using namespace std;
+
+Mat4::Mat4() {
+    for (int i = 0; i < 16; i++) m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+}
+
+Mat4 mat4Multiply(const Mat4& a, const Mat4& b) {
+    Mat4 r;
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a.m[k * 4 + row] * b.m[col * 4 + k];
+            }
+            r.m[col * 4 + row] = sum;
+        }
+    }
+    return r;
+}
+
+Mat4 mat4FromTransform(const Transform& t) {
+    Mat4 r;
+    if (t.type == TRANSLATE) {
+        r.m[12] = t.x;
+        r.m[13] = t.y;
+        r.m[14] = t.z;
+    } else if (t.type == SCALE) {
+        r.m[0] = t.x;
+        r.m[5] = t.y;
+        r.m[10] = t.z;
+    } else if (t.type == ROTATE) {
+        // Same axis-angle matrix as glRotatef (axis is normalized, angle in degrees)
+        float len = sqrt(t.x * t.x + t.y * t.y + t.z * t.z);
+        if (len == 0.0f) return r;
+        float x = t.x / len, y = t.y / len, z = t.z / len;
+        float rad = t.angle * M_PI / 180.0f;
+        float c = cos(rad), s = sin(rad), ic = 1.0f - c;
+        r.m[0] = x * x * ic + c;     r.m[4] = x * y * ic - z * s; r.m[8]  = x * z * ic + y * s;
+        r.m[1] = y * x * ic + z * s; r.m[5] = y * y * ic + c;     r.m[9]  = y * z * ic - x * s;
+        r.m[2] = x * z * ic - y * s; r.m[6] = y * z * ic + x * s; r.m[10] = z * z * ic + c;
+    }
+    return r;
+}
+
+void mat4Apply(Mat4& mat, const Transform& t) {
+    mat = mat4Multiply(mat, mat4FromTransform(t));
+}
+
+Mat4 mat4Linear(const Mat4& mat) {
+    Mat4 r = mat;
+    r.m[12] = r.m[13] = r.m[14] = 0.0f;
+    return r;
+}
+
+bool mat4IsIdentity(const Mat4& mat) {
+    for (int i = 0; i < 16; i++) {
+        if (mat.m[i] != ((i % 5 == 0) ? 1.0f : 0.0f)) return false;
+    }
+    return true;
+}
+
+Vertex mat4TransformPoint(const Mat4& mat, const Vertex& v) {
+    const float* m = mat.m;
+    Vertex r;
+    r.x = m[0] * v.x + m[4] * v.y + m[8]  * v.z + m[12];
+    r.y = m[1] * v.x + m[5] * v.y + m[9]  * v.z + m[13];
+    r.z = m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14];
+    return r;
+}
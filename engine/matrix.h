@@ -0,0 +1,40 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include "geometry.h"
+
+// ============================================================================
+// MATRIX MATH (column-major, same layout as OpenGL)
+// ============================================================================
+
+/**
+ * Multiply two matrices (a * b)
+ */
+Mat4 mat4Multiply(const Mat4& a, const Mat4& b);
+
+/**
+ * Build the matrix of a single static transform (translate, rotate or scale)
+ */
+Mat4 mat4FromTransform(const Transform& t);
+
+/**
+ * Post-multiply a matrix by a transform, like the matching glTranslatef/glRotatef/glScalef call
+ */
+void mat4Apply(Mat4& mat, const Transform& t);
+
+/**
+ * The rotation and scale of a matrix, without its translation
+ */
+Mat4 mat4Linear(const Mat4& mat);
+
+/**
+ * Whether a matrix is exactly the identity
+ */
+bool mat4IsIdentity(const Mat4& mat);
+
+/**
+ * Transform a point (w = 1) by a matrix
+ */
+Vertex mat4TransformPoint(const Mat4& mat, const Vertex& v);
+
+#endif // MATRIX_H
@@ -0,0 +1,258 @@
+#include "memory.h"
+#include "model.h"
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace std;
+
+// ============================================================================
+// PROCESS MEMORY
+// ============================================================================
+
+double peakMemoryMB() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);  // bytes
+#else
+    return usage.ru_maxrss / 1024.0;             // kilobytes
+#endif
+}
+
+double currentMemoryMB() {
+#ifdef __linux__
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f) {
+        long pages = 0, resident = 0;
+        int read = fscanf(f, "%ld %ld", &pages, &resident);
+        fclose(f);
+        if (read == 2) return resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+    }
+#endif
+    return peakMemoryMB();
+}
+
+// ============================================================================
+// LOAD HIGH-WATER MARKS
+// ============================================================================
+
+struct MemoryMark {
+    string stage;
+    double residentMB;
+    double peakMB;
+};
+
+// Loads can run on the reload thread
+static vector<MemoryMark> memoryMarks;
+static mutex memoryMarksLock;
+
+void resetMemoryMarks() {
+    lock_guard<mutex> guard(memoryMarksLock);
+    memoryMarks.clear();
+}
+
+void markMemory(const string& stage) {
+    double resident = currentMemoryMB();
+    MemoryMark mark = { stage, resident, max(resident, peakMemoryMB()) };
+    lock_guard<mutex> guard(memoryMarksLock);
+    memoryMarks.push_back(mark);
+}
+
+// ============================================================================
+// SIZE ESTIMATES
+// ============================================================================
+
+// Heap buffer of a string (0 while it fits in the small-string buffer)
+static size_t stringHeapBytes(const string& s) {
+    const char* data = s.data();
+    bool inline_ = data >= (const char*)&s && data < (const char*)(&s + 1);
+    return inline_ ? 0 : s.capacity() + 1;
+}
+
+// Links of a std::list node
+static const size_t LIST_NODE_LINKS = 2 * sizeof(void*);
+
+/**
+ * Bytes a group itself takes in the scene arena (children not included)
+ */
+static size_t groupNodeBytes(const Group& g) {
+    size_t bytes = sizeof(Group) + LIST_NODE_LINKS;
+    bytes += g.transforms.size() * (sizeof(Transform) + LIST_NODE_LINKS);
+    for (const auto& m : g.models) {
+        bytes += sizeof(Model) + LIST_NODE_LINKS + stringHeapBytes(m.file);
+    }
+    bytes += g.sourceLines.capacity() * sizeof(int);
+    return bytes;
+}
+
+static size_t meshPayloadBytes(const Mesh& mesh) {
+    return mesh.vertexCount * sizeof(Vertex);
+}
+
+// Mesh payload lives in a snapshot mapping rather than on the heap
+static bool meshIsMapped(const Mesh& mesh) {
+    return mesh.storage.empty() && mesh.owner && mesh.vertexCount > 0;
+}
+
+/**
+ * Mesh struct, its name, unused vector capacity and the shared_ptr
+ * control block (make_shared puts the mesh inside it)
+ */
+static size_t meshOverheadBytes(const Mesh& mesh) {
+    return sizeof(Mesh) + 2 * sizeof(long) + stringHeapBytes(mesh.file) +
+           (mesh.storage.capacity() - mesh.storage.size()) * sizeof(Vertex);
+}
+
+// ============================================================================
+// SCENE WALK
+// ============================================================================
+
+struct MeshUsage {
+    const Mesh* mesh;
+    int models;    // models in the graph that reference it
+    long draws;    // times it is drawn per frame (instances expanded)
+    long cacheRefs;
+    size_t cacheBytes;
+    bool cached;
+    MeshUsage() : mesh(nullptr), models(0), draws(0), cacheRefs(0), cacheBytes(0), cached(false) {}
+};
+
+struct GroupUsage {
+    const Group* group;
+    string label;
+    size_t nodeBytes;
+    size_t meshBytes;  // payload of the meshes its own models draw
+};
+
+struct MemoryWalk {
+    map<const Mesh*, MeshUsage> meshes;
+    vector<GroupUsage> groups;
+    size_t graphBytes;
+    int groupCount;
+    MemoryWalk() : graphBytes(0), groupCount(0) {}
+
+    void stored(const Group& g, const string& label) {
+        GroupUsage usage = { &g, label, groupNodeBytes(g), 0 };
+        if (!g.sourceLines.empty()) usage.label = "line " + to_string(g.sourceLines.front());
+        for (const auto& m : g.models) {
+            MeshUsage& mu = meshes[m.mesh.get()];
+            mu.mesh = m.mesh.get();
+            mu.models++;
+            usage.meshBytes += meshPayloadBytes(*m.mesh);
+        }
+        graphBytes += usage.nodeBytes;
+        groupCount++;
+        groups.push_back(usage);
+        for (const auto& child : g.children) stored(child, "group");
+    }
+
+    void drawn(const Group& g) {
+        for (const auto& m : g.models) meshes[m.mesh.get()].draws++;
+        for (const auto& child : g.children) drawn(child);
+        if (g.instance) drawn(*g.instance);
+    }
+};
+
+static string kilobytes(size_t bytes) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.1f KB", bytes / 1024.0);
+    return text;
+}
+
+// ============================================================================
+// REPORT
+// ============================================================================
+
+void printMemoryReport(const Scene& scene, ostream& out) {
+    MemoryWalk walk;
+    walk.stored(scene.root, "root");
+    int prototypeIndex = 0;
+    for (const auto& prototype : scene.prototypes) {
+        walk.stored(prototype, "prototype " + to_string(prototypeIndex++));
+    }
+    walk.drawn(scene.root);
+
+    for (const auto& info : modelCacheContents()) {
+        MeshUsage& mu = walk.meshes[info.mesh.get()];
+        mu.mesh = info.mesh.get();
+        mu.cached = true;
+        mu.cacheRefs = info.refs;
+        mu.cacheBytes = info.entryBytes + stringHeapBytes(info.mesh->file);  // the key repeats the file name
+    }
+
+    out << fixed << setprecision(1);
+    out << "Memory report for " << scene.file << "\n";
+    double resident = currentMemoryMB();
+    out << "  Process: resident " << resident << " MB, peak " << max(resident, peakMemoryMB()) << " MB\n";
+    {
+        lock_guard<mutex> guard(memoryMarksLock);
+        if (!memoryMarks.empty()) {
+            out << "  Last load (resident / peak MB):";
+            for (const auto& mark : memoryMarks) {
+                out << "  " << mark.stage << " " << mark.residentMB << " / " << mark.peakMB;
+            }
+            out << "\n";
+        }
+    }
+
+    // Meshes, largest payload first
+    vector<MeshUsage> meshes;
+    for (const auto& entry : walk.meshes) meshes.push_back(entry.second);
+    sort(meshes.begin(), meshes.end(), [](const MeshUsage& a, const MeshUsage& b) {
+        return meshPayloadBytes(*a.mesh) > meshPayloadBytes(*b.mesh);
+    });
+    size_t heapPayload = 0, mappedPayload = 0, overhead = 0;
+    for (const auto& mu : meshes) {
+        (meshIsMapped(*mu.mesh) ? mappedPayload : heapPayload) += meshPayloadBytes(*mu.mesh);
+        overhead += meshOverheadBytes(*mu.mesh) + mu.cacheBytes;
+    }
+    out << "  Meshes: " << meshes.size() << ", payload " << kilobytes(heapPayload) << " on the heap";
+    if (mappedPayload) out << " + " << kilobytes(mappedPayload) << " mapped from the snapshot";
+    out << ", overhead " << kilobytes(overhead) << "\n";
+    out << "    " << left << setw(28) << "file" << right << setw(10) << "vertices"
+        << setw(14) << "payload" << setw(12) << "overhead"
+        << setw(8) << "models" << setw(8) << "draws" << setw(8) << "refs" << "\n";
+    for (const auto& mu : meshes) {
+        const Mesh& mesh = *mu.mesh;
+        string name = mesh.file.empty() ? "(unnamed)" : mesh.file;
+        if (meshIsMapped(mesh)) name += " [mapped]";
+        else if (!mu.cached) name += " [uncached]";
+        out << "    " << left << setw(28) << name << right << setw(10) << mesh.vertexCount
+            << setw(14) << kilobytes(meshPayloadBytes(mesh))
+            << setw(12) << kilobytes(meshOverheadBytes(mesh) + mu.cacheBytes)
+            << setw(8) << mu.models << setw(8) << mu.draws;
+        if (mu.cached) out << setw(8) << mu.cacheRefs; else out << setw(8) << "-";
+        out << "\n";
+    }
+
+    // Scene graph
+    out << "  Scene graph: " << walk.groupCount << " groups (" << scene.prototypes.size()
+        << " prototypes), " << kilobytes(walk.graphBytes) << " in nodes; arena "
+        << kilobytes(scene.arena.bytes) << " used of " << kilobytes(scene.arena.upstream.bytes)
+        << " in " << scene.arena.upstream.blocks << " blocks; physics "
+        << kilobytes(scene.physics.bodies.capacity() * sizeof(Body)) << " for "
+        << scene.physics.bodies.size() << " bodies\n";
+
+    // Groups holding the most memory (node plus the meshes it draws)
+    sort(walk.groups.begin(), walk.groups.end(), [](const GroupUsage& a, const GroupUsage& b) {
+        return a.nodeBytes + a.meshBytes > b.nodeBytes + b.meshBytes;
+    });
+    size_t shown = min<size_t>(walk.groups.size(), 10);
+    out << "  Largest groups:\n";
+    for (size_t i = 0; i < shown; i++) {
+        const GroupUsage& gu = walk.groups[i];
+        out << "    " << left << setw(16) << gu.label << right
+            << " node " << setw(10) << kilobytes(gu.nodeBytes)
+            << "  meshes " << setw(10) << kilobytes(gu.meshBytes);
+        for (const auto& m : gu.group->models) out << " " << m.file;
+        out << "\n";
+    }
+    out << defaultfloat << setprecision(6);
+    out.flush();
+}
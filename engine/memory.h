@@ -0,0 +1,41 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <ostream>
+#include <string>
+#include "scene.h"
+
+using namespace std;
+
+// ============================================================================
+// MEMORY STATISTICS
+// ============================================================================
+
+/**
+ * Peak resident set size of the process in MB
+ */
+double peakMemoryMB();
+
+/**
+ * Current resident set size in MB (the peak where it can't be read)
+ */
+double currentMemoryMB();
+
+/**
+ * Start a new list of load marks (called when a load begins)
+ */
+void resetMemoryMarks();
+
+/**
+ * Record the current and peak resident size at a stage of a load
+ */
+void markMemory(const string& stage);
+
+/**
+ * Print where a scene's memory goes: process and load high-water marks,
+ * each mesh (payload vs container overhead, models and draws using it),
+ * the scene graph and its largest groups (key U, --memory-report)
+ */
+void printMemoryReport(const Scene& scene, ostream& out);
+
+#endif // MEMORY_H
@@ -1,4 +1,9 @@
 #include "menu.h"
+#include "scene.h"
+#include "scheduler.h"
+#include "profiler.h"
+#include "memory.h"
+#include <cstring>
 
 // ============================================================================
 // MENU FUNCTIONS
@@ -16,8 +21,13 @@ void displayMenu() {
               << (enableCulling ? "✓ ON " : "✗ OFF") << "                  ║\n";
     std::cout << "║  O - Show FPS:  "
               << (showFPS ? "✓ ON " : "✗ OFF") << "                  ║\n";
+    std::cout << "║  T - Frame stats: "
+              << (showFrameStats ? "✓ ON " : "✗ OFF") << "                ║\n";
     std::cout << "║  A - Show Axes: "
               << (showAxes ? "✓ ON " : "✗ OFF") << "                  ║\n";
+    std::cout << "║  V - Frames:    " << frameModeName(frameMode);
+    for (int pad = strlen(frameModeName(frameMode)); pad < 23; pad++) std::cout << ' ';
+    std::cout << "║\n";
     std::cout << "║                                        ║\n";
     std::cout << "║  CAMERA CONTROLS:                     ║\n";
     std::cout << "║  I/K - Rotate vertical (orbital)      ║\n";
@@ -30,7 +40,16 @@ void displayMenu() {
     std::cout << "║  W/S - Move forward/backward          ║\n";
     std::cout << "║  A/D - Move left/right                ║\n";
     std::cout << "║                                        ║\n";
+    std::cout << "║  PHYSICS:                             ║\n";
+    std::cout << "║  P   - Pause/resume simulation        ║\n";
+    std::cout << "║  G   - Gravity: "
+              << (activeScene->physics.settings.method == FORCE_DIRECT ? "direct     " : "Barnes-Hut ")
+              << "           ║\n";
+    std::cout << "║                                        ║\n";
     std::cout << "║  R   - Reload config                  ║\n";
+    std::cout << "║  U   - Memory report                  ║\n";
+    std::cout << "║  X   - Cycle cost views               ║\n";
+    std::cout << "║  Z   - Cost report (worst models)     ║\n";
     std::cout << "║  M   - Show this menu                 ║\n";
     std::cout << "║  ESC - Exit                           ║\n";
     std::cout << "║                                        ║\n";
@@ -50,6 +69,7 @@ void toggleCulling() {
 
 void toggleShowFPS() {
     showFPS = !showFPS;
+    showEntityCount = showFPS;
     std::cout << "→ Show FPS: " << (showFPS ? "ON ✓" : "OFF ✗") << std::endl;
 }
 
@@ -57,3 +77,26 @@ void toggleShowAxes() {
     showAxes = !showAxes;
     std::cout << "→ Show Axes: " << (showAxes ? "ON ✓" : "OFF ✗") << std::endl;
 }
+
+
+void togglePhysicsPaused() {
+    activeScene->physics.paused = !activeScene->physics.paused;
+    std::cout << "→ Physics: " << (activeScene->physics.paused ? "PAUSED" : "RUNNING") << std::endl;
+}
+
+void toggleForceMethod() {
+    PhysicsSettings& s = activeScene->physics.settings;
+    s.method = (s.method == FORCE_DIRECT) ? FORCE_BARNES_HUT : FORCE_DIRECT;
+    activeScene->physics.forcesValid = false;
+    std::cout << "→ Gravity: " << (s.method == FORCE_DIRECT ? "direct O(n²)" : "Barnes-Hut") << std::endl;
+}
+
+void toggleFrameMode() {
+    cycleFrameMode();
+    std::cout << "→ Frames: " << frameModeName(frameMode);
+    if (frameMode == FRAME_CAPPED) std::cout << " (" << targetFPS << " FPS)";
+    std::cout << std::endl;
+}
+void showMemoryReport() {
+    printMemoryReport(*activeScene, std::cout);
+}
@@ -11,6 +11,7 @@
 extern bool wireframeMode;
 extern bool enableCulling;
 extern bool showFPS;
+extern bool showEntityCount;
 extern bool showAxes;
 
 /**
@@ -29,7 +30,7 @@ void toggleWireframe();
 void toggleCulling();
 
 /**
- * Toggle FPS display
+ * Toggle FPS and drawn-model count display
  */
 void toggleShowFPS();
 
@@ -38,4 +39,24 @@ void toggleShowFPS();
  */
 void toggleShowAxes();
 
+/**
+ * Pause/resume the physics simulation
+ */
+void togglePhysicsPaused();
+
+/**
+ * Switch gravity between Barnes-Hut and direct summation
+ */
+void toggleForceMethod();
+
+/**
+ * Cycle the frame scheduler mode (on-demand, capped, uncapped)
+ */
+void toggleFrameMode();
+
+/**
+ * Print the memory report of the active scene
+ */
+void showMemoryReport();
+
 #endif // MENU_H
@@ -1,23 +1,94 @@
 #include "model.h"
+#include "../include/trace.h"
+#include "../include/figure_format.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <map>
+#include <algorithm>
+#include <mutex>
+#include <sys/stat.h>
 
 using namespace std;
 
-map<string, list<Vertex>> modelCache;
+struct CachedMesh {
+    MeshPtr mesh;
+    long long modified;  // file timestamp (ns) and size when loaded,
+    long long size;      // used to reuse the mesh across reloads
+};
+
+map<string, CachedMesh> modelCache;
+mutex modelCacheLock;
 
 /**
  * Load a .3d model file
  */
-list<Vertex> loadModelFile(const char* filename) {
-    list<Vertex> vertices;
-    ifstream file(filename);
+shared_ptr<Mesh> loadModelFile(const char* filename) {
+    TraceScope trace("loadModelFile", "model", filename);
+    ifstream file(filename, ios::binary);
     if (!file.is_open()) {
         cerr << "Error: Could not open model file " << filename << endl;
-        return vertices;
+        return make_shared<Mesh>();
+    }
+
+    file.seekg(0, ios::end);
+    uint64_t fileBytes = (uint64_t)file.tellg();
+    file.seekg(0);
+
+    // Binary figure (generator --binary): the vertices are read straight into the mesh
+    FigureBinaryHeader header;
+    if (file.read((char*)&header, sizeof(header)) && isBinaryFigureHeader(header)) {
+        shared_ptr<Mesh> mesh = make_shared<Mesh>();
+        if (!figureFitsFile(header, 0, fileBytes)) {
+            cerr << "Error: " << filename << " is shorter than its header says" << endl;
+            return mesh;
+        }
+        mesh->storage.resize(header.vertexCount);
+        if (!file.read((char*)mesh->storage.data(), header.vertexCount * sizeof(Vertex))) {
+            cerr << "Error: Could not read " << filename << endl;
+            mesh->storage.clear();
+        }
+        mesh->vertices = mesh->storage.data();
+        mesh->vertexCount = mesh->storage.size();
+        return mesh;
     }
 
+    // Indexed figure (generator --indexed): expanded back to a triangle list
+    if (file && isIndexedFigureHeader(header)) {
+        shared_ptr<Mesh> mesh = make_shared<Mesh>();
+        uint64_t indexCount = 0;
+        if (!file.read((char*)&indexCount, sizeof(indexCount)) ||
+            !figureFitsFile(header, indexCount, fileBytes)) {
+            cerr << "Error: " << filename << " is shorter than its header says" << endl;
+            return mesh;
+        }
+        if (indexCount % 3 != 0) {
+            cerr << "Error: " << filename << " has " << indexCount << " indices, not whole triangles" << endl;
+            return mesh;
+        }
+        vector<Vertex> unique(header.vertexCount);
+        vector<uint32_t> indices(indexCount);
+        if (!file.read((char*)unique.data(), unique.size() * sizeof(Vertex)) ||
+            !file.read((char*)indices.data(), indices.size() * sizeof(uint32_t))) {
+            cerr << "Error: Could not read " << filename << endl;
+            return mesh;
+        }
+        for (uint32_t i : indices) {
+            if (i >= unique.size()) {
+                cerr << "Error: " << filename << " has an index out of range (" << i << " of "
+                     << unique.size() << " vertices)" << endl;
+                return mesh;
+            }
+        }
+        mesh->storage.reserve(indices.size());
+        for (uint32_t i : indices) mesh->storage.push_back(unique[i]);
+        mesh->vertices = mesh->storage.data();
+        mesh->vertexCount = mesh->storage.size();
+        return mesh;
+    }
+    file.clear();
+    file.seekg(0);
+
     string line;
     int expectedCount = -1;
     if (getline(file, line)) {
@@ -25,35 +96,115 @@ list<Vertex> loadModelFile(const char* filename) {
         iss >> expectedCount;
     }
 
+    shared_ptr<Mesh> mesh = make_shared<Mesh>();
+    // Trust the count only as far as the file can hold it ("0 0 0" lines are the shortest)
+    const uint64_t shortestLine = 6;
+    if (expectedCount > 0) mesh->storage.reserve(min((uint64_t)expectedCount, fileBytes / shortestLine));
+
     int loadedCount = 0;
     while (getline(file, line)) {
         istringstream iss(line);
         Vertex v;
         if (iss >> v.x >> v.y >> v.z) {
-            vertices.push_back(v);
+            mesh->storage.push_back(v);
             loadedCount++;
         }
     }
 
     file.close();
-    return vertices;
+    mesh->vertices = mesh->storage.data();
+    mesh->vertexCount = mesh->storage.size();
+    return mesh;
 }
 
 /**
- * Get model vertices (with caching)
+ * Path of a figure file relative to the engine's build directory
  */
-list<Vertex> getModelVertices(const string& filename) {
-    if (modelCache.find(filename) == modelCache.end()) {
-        string modelPath = "../../figures/";
-        modelPath += filename;
-        modelCache[filename] = loadModelFile(modelPath.c_str());
+string modelFilePath(const string& filename) {
+    return "../../figures/" + filename;
+}
+
+/**
+ * File timestamp in nanoseconds where available (several saves can land in
+ * the same second while editing), or 0 if the file is missing
+ */
+static void fileStamp(const string& path, long long& modified, long long& size) {
+    struct stat st;
+    modified = 0;
+    size = 0;
+    if (stat(path.c_str(), &st) != 0) return;
+#ifdef __linux__
+    modified = (long long)st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#else
+    modified = (long long)st.st_mtime * 1000000000LL;
+#endif
+    size = st.st_size;
+}
+
+/**
+ * Get a model's mesh (with caching)
+ */
+MeshPtr getModelVertices(const string& filename) {
+    string modelPath = modelFilePath(filename);
+    long long modified, size;
+    fileStamp(modelPath, modified, size);
+
+    lock_guard<mutex> guard(modelCacheLock);
+    auto it = modelCache.find(filename);
+    if (it != modelCache.end() && it->second.modified == modified && it->second.size == size) {
+        return it->second.mesh;
+    }
+
+    shared_ptr<Mesh> mesh = loadModelFile(modelPath.c_str());
+    mesh->file = filename;
+    CachedMesh& entry = modelCache[filename];
+    entry.mesh = mesh;
+    entry.modified = modified;
+    entry.size = size;
+    return mesh;
+}
+
+/**
+ * Re-read a model even if its timestamp looks unchanged
+ */
+MeshPtr reloadModel(const string& filename) {
+    {
+        lock_guard<mutex> guard(modelCacheLock);
+        modelCache.erase(filename);
+    }
+    return getModelVertices(filename);
+}
+
+/**
+ * Drop meshes only the cache still holds
+ */
+void pruneModelCache() {
+    lock_guard<mutex> guard(modelCacheLock);
+    for (auto it = modelCache.begin(); it != modelCache.end(); ) {
+        if (it->second.mesh.use_count() == 1) {
+            it = modelCache.erase(it);
+        } else {
+            ++it;
+        }
     }
-    return modelCache[filename];
 }
 
 /**
  * Clear the model cache
  */
 void clearModelCache() {
+    lock_guard<mutex> guard(modelCacheLock);
     modelCache.clear();
 }
+
+vector<CachedMeshInfo> modelCacheContents() {
+    lock_guard<mutex> guard(modelCacheLock);
+    vector<CachedMeshInfo> contents;
+    for (const auto& entry : modelCache) {
+        long refs = entry.second.mesh.use_count() - 1;
+        // Tree nodes hold the entry plus parent/left/right links and a color
+        CachedMeshInfo info = { entry.second.mesh, refs, sizeof(entry) + 4 * sizeof(void*) };
+        contents.push_back(info);
+    }
+    return contents;
+}
@@ -3,7 +3,8 @@
 
 #include <list>
 #include <string>
-#include <map>
+#include <memory>
+#include <vector>
 #include "geometry.h"
 
 using namespace std;
@@ -12,21 +13,48 @@ using namespace std;
 // MODEL MANAGEMENT
 // ============================================================================
 
-extern map<string, list<Vertex>> modelCache;
+typedef shared_ptr<const Mesh> MeshPtr;
 
 /**
- * Load a .3d model file
+ * Load a .3d model file into a new mesh (one contiguous vertex array)
  */
-list<Vertex> loadModelFile(const char* filename);
+shared_ptr<Mesh> loadModelFile(const char* filename);
 
 /**
- * Get model vertices (with caching)
+ * Get a model's mesh (cached; re-read only if the file changed on disk).
+ * Safe to call from the background reload thread.
  */
-list<Vertex> getModelVertices(const string& filename);
+MeshPtr getModelVertices(const string& filename);
+
+/**
+ * Re-read a model from disk, replacing its cache entry
+ */
+MeshPtr reloadModel(const string& filename);
+
+/**
+ * Path of a figure file (models are looked up in the figures directory)
+ */
+string modelFilePath(const string& filename);
+
+/**
+ * Drop cached meshes that no loaded scene references any more
+ */
+void pruneModelCache();
 
 /**
  * Clear the model cache
  */
 void clearModelCache();
 
+struct CachedMeshInfo {
+    MeshPtr mesh;
+    long refs;          // owners other than the cache
+    size_t entryBytes;  // cache map node (without the key's heap buffer)
+};
+
+/**
+ * Snapshot of the cache for memory reports
+ */
+vector<CachedMeshInfo> modelCacheContents();
+
 #endif // MODEL_H
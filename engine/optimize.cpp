@@ -0,0 +1,204 @@
+#include "optimize.h"
+#include "matrix.h"
+#include "../include/trace.h"
+#include <iostream>
+#include <map>
+
+using namespace std;
+
+bool optimizeScenes = true;
+
+// ============================================================================
+// COST ESTIMATE
+// ============================================================================
+
+struct CostWalk {
+    const PhysicsWorld& physics;
+    bool redundantState;
+    bool haveColor;
+    float r, g, b;
+    bool culling;
+    GraphCost cost;
+
+    CostWalk(const PhysicsWorld& p, bool redundant) :
+        physics(p), redundantState(redundant), haveColor(false),
+        r(0.0f), g(0.0f), b(0.0f), culling(true) {}
+
+    void visit(const Group& group) {
+        bool simulated = group.body >= 0 && physics.settings.enabled;
+        cost.visits++;
+        cost.matrixOps += 2;  // push/pop
+        if (simulated) cost.matrixOps += 2;
+        if (group.hasMatrix) cost.matrixOps++;
+        for (const auto& t : group.transforms) {
+            if (t.type != TRANSLATE || !simulated) cost.matrixOps++;
+        }
+
+        for (const auto& m : group.models) {
+            cost.triangles += m.mesh->vertexCount / 3;
+            if (redundantState) {
+                cost.stateChanges += m.cull ? 1 : 3;
+                continue;
+            }
+            if (!haveColor || m.r != r || m.g != g || m.b != b) {
+                cost.stateChanges++;
+                haveColor = true;
+                r = m.r; g = m.g; b = m.b;
+            }
+            if (m.cull != culling) {
+                cost.stateChanges++;
+                culling = m.cull;
+            }
+        }
+
+        for (const auto& child : group.children) visit(child);
+        if (group.instance) visit(*group.instance);
+    }
+};
+
+static int countGroups(const Group& g) {
+    int n = 1;
+    for (const auto& child : g.children) n += countGroups(child);
+    return n;
+}
+
+GraphCost measureSceneGraph(const Scene& scene, bool redundantState) {
+    CostWalk walk(scene.physics, redundantState);
+    walk.visit(scene.root);
+    walk.cost.groups = countGroups(scene.root);
+    for (const auto& prototype : scene.prototypes) {
+        walk.cost.groups += countGroups(prototype);
+    }
+    return walk.cost;
+}
+
+// ============================================================================
+// OPTIMIZATION PASS
+// ============================================================================
+
+static bool isSimulated(const Group& g, const PhysicsWorld& physics) {
+    return g.body >= 0 && physics.settings.enabled;
+}
+
+/**
+ * Replace the transform list by one matrix (bodies skip their translations
+ * at draw time, so those are dropped); identity matrices are removed
+ */
+static void collapseTransforms(Group& g, const PhysicsWorld& physics) {
+    if (!g.transforms.empty()) {
+        bool simulated = isSimulated(g, physics);
+        Mat4 mat;
+        if (g.hasMatrix) mat = g.matrix;
+        for (const auto& t : g.transforms) {
+            if (t.type == TRANSLATE && simulated) continue;
+            mat4Apply(mat, t);
+        }
+        g.transforms.clear();
+        g.matrix = mat;
+        g.hasMatrix = true;
+    }
+    if (g.hasMatrix && mat4IsIdentity(g.matrix)) {
+        g.hasMatrix = false;
+        g.matrix = Mat4();
+    }
+}
+
+static bool isEmptyLeaf(const Group& g) {
+    return g.models.empty() && g.children.empty() && !g.instance && g.body < 0;
+}
+
+static bool isFoldable(const Group& g) {
+    return g.models.empty() && g.children.size() == 1 && !g.instance && g.body < 0;
+}
+
+/**
+ * Merge a group with no content of its own into its only child
+ */
+static void foldIntoChild(Group& g, const PhysicsWorld& physics) {
+    Group& child = g.children.front();
+    // A simulated child is placed in world space, so only the parent's rotation and scale apply to it
+    if (g.hasMatrix) {
+        Mat4 parent = isSimulated(child, physics) ? mat4Linear(g.matrix) : g.matrix;
+        child.matrix = child.hasMatrix ? mat4Multiply(parent, child.matrix) : parent;
+        child.hasMatrix = !mat4IsIdentity(child.matrix);
+    }
+    child.sourceLines.insert(child.sourceLines.begin(), g.sourceLines.begin(), g.sourceLines.end());
+    Group folded(move(child), g.children.get_allocator());
+    g = move(folded);
+}
+
+static void optimizeGroup(Group& g, const PhysicsWorld& physics) {
+    collapseTransforms(g, physics);
+    for (auto it = g.children.begin(); it != g.children.end(); ) {
+        optimizeGroup(*it, physics);
+        while (isFoldable(*it)) foldIntoChild(*it, physics);
+        if (isEmptyLeaf(*it)) {
+            it = g.children.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void optimizeScene(Scene& scene) {
+    TraceScope trace("optimizeScene", "config", scene.file.c_str());
+    // Both sides with the renderer's state tracking, so the numbers only
+    // show what the pass changed; the untracked count is reported beside them
+    GraphCost before = measureSceneGraph(scene, false);
+    int untrackedStateChanges = measureSceneGraph(scene, true).stateChanges;
+
+    // Prototypes are folded in place, so instance pointers stay valid
+    for (auto& prototype : scene.prototypes) {
+        optimizeGroup(prototype, scene.physics);
+        while (isFoldable(prototype)) foldIntoChild(prototype, scene.physics);
+    }
+    optimizeGroup(scene.root, scene.physics);
+
+    GraphCost after = measureSceneGraph(scene, false);
+    cout << "Scene graph optimized: groups " << before.groups << " -> " << after.groups
+         << ", visits/frame " << before.visits << " -> " << after.visits
+         << ", matrix ops/frame " << before.matrixOps << " -> " << after.matrixOps
+         << ", state changes/frame " << before.stateChanges << " -> " << after.stateChanges
+         << " (" << untrackedStateChanges << " without state tracking)" << endl;
+}
+
+// ============================================================================
+// SOURCE MAP DUMP
+// ============================================================================
+
+static void dumpGroup(const Group& g, const map<const Group*, int>& prototypeIds,
+                      int depth, ostream& out) {
+    out << string(depth * 2, ' ') << "group";
+    if (!g.sourceLines.empty()) {
+        out << (g.sourceLines.size() == 1 ? " [line " : " [lines ");
+        for (size_t i = 0; i < g.sourceLines.size(); i++) {
+            out << (i ? ", " : "") << g.sourceLines[i];
+        }
+        out << "]";
+    }
+    if (g.hasMatrix) out << " matrix";
+    if (!g.transforms.empty()) out << " " << g.transforms.size() << " transforms";
+    for (const auto& m : g.models) out << " " << m.file;
+    if (g.body >= 0) out << " body " << g.body;
+    if (g.instance) out << " -> prototype " << prototypeIds.at(g.instance);
+    out << "\n";
+    for (const auto& child : g.children) {
+        dumpGroup(child, prototypeIds, depth + 1, out);
+    }
+}
+
+void dumpSceneGraph(const Scene& scene, ostream& out) {
+    map<const Group*, int> prototypeIds;
+    for (const auto& prototype : scene.prototypes) {
+        int id = prototypeIds.size();
+        prototypeIds[&prototype] = id;
+    }
+
+    out << "Scene graph of " << scene.file << ":\n";
+    for (const auto& prototype : scene.prototypes) {
+        out << "prototype " << prototypeIds[&prototype] << ":\n";
+        dumpGroup(prototype, prototypeIds, 1, out);
+    }
+    dumpGroup(scene.root, prototypeIds, 0, out);
+    out.flush();
+}
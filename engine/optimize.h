@@ -0,0 +1,43 @@
+#ifndef OPTIMIZE_H
+#define OPTIMIZE_H
+
+#include <ostream>
+#include "scene.h"
+
+using namespace std;
+
+// ============================================================================
+// SCENE GRAPH OPTIMIZATION
+// ============================================================================
+
+extern bool optimizeScenes;  // run the pass on load (--no-optimize turns it off)
+
+// Per-frame cost of drawing a scene graph (instances counted once per use)
+struct GraphCost {
+    int groups;        // nodes stored (tree and prototypes)
+    int visits;        // groups visited per frame
+    int matrixOps;     // push/pop, load and transform calls per frame
+    int stateChanges;  // color and culling calls per frame
+    long long triangles;  // triangles submitted per frame
+    GraphCost() : groups(0), visits(0), matrixOps(0), stateChanges(0), triangles(0) {}
+};
+
+/**
+ * Estimate the per-frame cost of a scene graph; redundantState counts a
+ * color/culling call for every model (the renderer before state tracking)
+ */
+GraphCost measureSceneGraph(const Scene& scene, bool redundantState);
+
+/**
+ * Collapse each group's static transforms into one matrix, drop identity
+ * matrices, fold empty single-child groups into their child and remove
+ * empty leaves; prints a before/after report
+ */
+void optimizeScene(Scene& scene);
+
+/**
+ * Print the scene graph with the config lines each group came from
+ */
+void dumpSceneGraph(const Scene& scene, ostream& out);
+
+#endif // OPTIMIZE_H
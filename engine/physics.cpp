@@ -0,0 +1,415 @@
+#include "physics.h"
+#include "matrix.h"
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+// ============================================================================
+// WORKER POOL
+// ============================================================================
+
+// Persistent threads for the force loop, so each step does not pay for
+// thread creation. Work is handed out in chunks through an atomic counter,
+// which balances the uneven per-body cost of the octree walk.
+struct WorkerPool {
+    vector<thread> threads;
+    mutex lock;
+    condition_variable wake;
+    condition_variable finished;
+    const function<void(int, int)>* job;
+    int count;
+    int grain;
+    atomic<int> next;
+    int generation;
+    int running;
+    bool quit;
+
+    WorkerPool() : job(nullptr), count(0), grain(1), next(0),
+                   generation(0), running(0), quit(false) {}
+
+    ~WorkerPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            quit = true;
+        }
+        wake.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    void drain() {
+        int begin;
+        while ((begin = next.fetch_add(grain)) < count) {
+            int end = begin + grain < count ? begin + grain : count;
+            (*job)(begin, end);
+        }
+    }
+
+    void workerLoop() {
+        int seen = 0;
+        while (true) {
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [&] { return quit || generation != seen; });
+                if (quit) return;
+                seen = generation;
+            }
+            drain();
+            {
+                lock_guard<mutex> guard(lock);
+                running--;
+            }
+            finished.notify_one();
+        }
+    }
+
+    void resize(int workers) {
+        while ((int)threads.size() < workers) {
+            threads.emplace_back(&WorkerPool::workerLoop, this);
+        }
+    }
+
+    void run(int n, int chunk, int workers, const function<void(int, int)>& fn) {
+        if (workers <= 1 || n <= chunk) {
+            fn(0, n);
+            return;
+        }
+        resize(workers - 1);  // the calling thread works too
+        {
+            lock_guard<mutex> guard(lock);
+            job = &fn;
+            count = n;
+            grain = chunk;
+            next = 0;
+            running = (int)threads.size();
+            generation++;
+        }
+        wake.notify_all();
+        drain();
+        unique_lock<mutex> guard(lock);
+        finished.wait(guard, [&] { return running == 0; });
+        job = nullptr;
+    }
+};
+
+static WorkerPool pool;
+
+static int workerCount(const PhysicsSettings& s) {
+    if (s.threads > 0) return s.threads;
+    unsigned hw = thread::hardware_concurrency();
+    return hw > 0 ? (int)hw : 1;
+}
+
+// ============================================================================
+// BODY SETUP
+// ============================================================================
+
+int addBody(PhysicsWorld& world, float mass, float vx, float vy, float vz) {
+    Body b;
+    b.x = b.y = b.z = 0.0f;
+    b.vx = vx; b.vy = vy; b.vz = vz;
+    b.ax = b.ay = b.az = 0.0f;
+    b.mass = mass;
+    world.bodies.push_back(b);
+    world.forcesValid = false;
+    return (int)world.bodies.size() - 1;
+}
+
+static void placeGroupBodies(PhysicsWorld& world, const Group& g, Mat4 mat) {
+    if (g.hasMatrix) {
+        mat = mat4Multiply(mat, g.matrix);
+    }
+    for (const auto& t : g.transforms) {
+        mat4Apply(mat, t);
+    }
+    if (g.body >= 0 && g.body < (int)world.bodies.size()) {
+        Vertex origin = {0.0f, 0.0f, 0.0f};
+        Vertex p = mat4TransformPoint(mat, origin);
+        Body& b = world.bodies[g.body];
+        b.x = p.x; b.y = p.y; b.z = p.z;
+    }
+    for (const auto& child : g.children) {
+        placeGroupBodies(world, child, mat);
+    }
+}
+
+void placeBodies(PhysicsWorld& world, const Group& root) {
+    placeGroupBodies(world, root, Mat4());
+    world.forcesValid = false;
+}
+
+// ============================================================================
+// DIRECT SUMMATION
+// ============================================================================
+
+void computeForcesDirect(PhysicsWorld& world) {
+    vector<Body>& bodies = world.bodies;
+    const int n = (int)bodies.size();
+    const float G = world.settings.G;
+    const float eps2 = world.settings.softening * world.settings.softening;
+
+    function<void(int, int)> job = [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            const float xi = bodies[i].x, yi = bodies[i].y, zi = bodies[i].z;
+            float ax = 0.0f, ay = 0.0f, az = 0.0f;
+            for (int j = 0; j < n; j++) {
+                if (j == i) continue;
+                float dx = bodies[j].x - xi;
+                float dy = bodies[j].y - yi;
+                float dz = bodies[j].z - zi;
+                float d2 = dx * dx + dy * dy + dz * dz + eps2;
+                float inv = 1.0f / sqrt(d2);
+                float s = bodies[j].mass * inv * inv * inv;
+                ax += dx * s; ay += dy * s; az += dz * s;
+            }
+            bodies[i].ax = G * ax;
+            bodies[i].ay = G * ay;
+            bodies[i].az = G * az;
+        }
+    };
+    pool.run(n, 16, workerCount(world.settings), job);
+    world.forcesValid = true;
+}
+
+// ============================================================================
+// BARNES-HUT OCTREE
+// ============================================================================
+
+struct OctreeNode {
+    float cx, cy, cz, half;   // cell center and half size
+    float mx, my, mz, mass;   // mass-weighted position sum, then center of mass
+    int children;             // index of the first of 8 children (-1 = leaf)
+    int body;                 // body stored in a leaf (-1 = empty)
+};
+
+static const int MAX_OCTREE_DEPTH = 32;  // coincident bodies share a leaf past this
+
+static vector<OctreeNode> octree;  // reused between steps to keep its capacity
+static vector<int> treeOrder;      // bodies in octree leaf order, for cache-friendly walks
+
+static int newNode(float cx, float cy, float cz, float half) {
+    OctreeNode node;
+    node.cx = cx; node.cy = cy; node.cz = cz; node.half = half;
+    node.mx = node.my = node.mz = node.mass = 0.0f;
+    node.children = -1;
+    node.body = -1;
+    octree.push_back(node);
+    return (int)octree.size() - 1;
+}
+
+static int childIndex(const OctreeNode& node, const Body& b) {
+    return (b.x >= node.cx ? 1 : 0) | (b.y >= node.cy ? 2 : 0) | (b.z >= node.cz ? 4 : 0);
+}
+
+static void addMass(OctreeNode& node, const Body& b) {
+    node.mx += b.x * b.mass;
+    node.my += b.y * b.mass;
+    node.mz += b.z * b.mass;
+    node.mass += b.mass;
+}
+
+static void subdivide(int nodeIndex) {
+    OctreeNode parent = octree[nodeIndex];
+    float h = parent.half * 0.5f;
+    int first = (int)octree.size();
+    for (int c = 0; c < 8; c++) {
+        newNode(parent.cx + ((c & 1) ? h : -h),
+                parent.cy + ((c & 2) ? h : -h),
+                parent.cz + ((c & 4) ? h : -h), h);
+    }
+    octree[nodeIndex].children = first;
+}
+
+static void insertBody(const vector<Body>& bodies, int i) {
+    const Body& b = bodies[i];
+    int node = 0;
+    for (int depth = 0; ; depth++) {
+        if (octree[node].children < 0) {
+            if (octree[node].body == -1) {
+                addMass(octree[node], b);  // empty leaf
+                octree[node].body = i;
+                return;
+            }
+            if (octree[node].body == -2 || depth >= MAX_OCTREE_DEPTH) {
+                addMass(octree[node], b);  // shared leaf, acts through its center of mass
+                octree[node].body = -2;
+                return;
+            }
+            // Push the resident body one level down, then keep descending
+            int resident = octree[node].body;
+            subdivide(node);
+            octree[node].body = -1;
+            int c = octree[node].children + childIndex(octree[node], bodies[resident]);
+            addMass(octree[c], bodies[resident]);
+            octree[c].body = resident;
+        }
+        addMass(octree[node], b);
+        node = octree[node].children + childIndex(octree[node], b);
+    }
+}
+
+static void buildOctree(const vector<Body>& bodies) {
+    octree.clear();
+    if (bodies.empty()) return;
+
+    float minX = bodies[0].x, maxX = bodies[0].x;
+    float minY = bodies[0].y, maxY = bodies[0].y;
+    float minZ = bodies[0].z, maxZ = bodies[0].z;
+    for (const auto& b : bodies) {
+        minX = fmin(minX, b.x); maxX = fmax(maxX, b.x);
+        minY = fmin(minY, b.y); maxY = fmax(maxY, b.y);
+        minZ = fmin(minZ, b.z); maxZ = fmax(maxZ, b.z);
+    }
+    float half = fmax(maxX - minX, fmax(maxY - minY, maxZ - minZ)) * 0.5f + 1e-3f;
+    newNode((minX + maxX) * 0.5f, (minY + maxY) * 0.5f, (minZ + maxZ) * 0.5f, half);
+
+    for (int i = 0; i < (int)bodies.size(); i++) {
+        insertBody(bodies, i);
+    }
+    for (auto& node : octree) {
+        if (node.mass > 0.0f) {
+            node.mx /= node.mass;
+            node.my /= node.mass;
+            node.mz /= node.mass;
+        }
+    }
+
+    // Neighbouring bodies walk nearly the same cells, so visit them together
+    treeOrder.clear();
+    vector<int> stack(1, 0);
+    while (!stack.empty()) {
+        const OctreeNode& node = octree[stack.back()];
+        stack.pop_back();
+        if (node.children >= 0) {
+            for (int c = 7; c >= 0; c--) stack.push_back(node.children + c);
+        } else if (node.body >= 0) {
+            treeOrder.push_back(node.body);
+        }
+    }
+    // Bodies sharing a depth-limited leaf are not listed there
+    if (treeOrder.size() != bodies.size()) {
+        treeOrder.resize(bodies.size());
+        for (int i = 0; i < (int)bodies.size(); i++) treeOrder[i] = i;
+    }
+}
+
+void computeForcesBarnesHut(PhysicsWorld& world) {
+    vector<Body>& bodies = world.bodies;
+    buildOctree(bodies);
+
+    const float G = world.settings.G;
+    const float eps2 = world.settings.softening * world.settings.softening;
+    const float theta2 = world.settings.theta * world.settings.theta;
+
+    function<void(int, int)> job = [&](int begin, int end) {
+        vector<int> stack;
+        stack.reserve(8 * MAX_OCTREE_DEPTH + 8);
+        for (int k = begin; k < end; k++) {
+            const int i = treeOrder[k];
+            const float xi = bodies[i].x, yi = bodies[i].y, zi = bodies[i].z;
+            float ax = 0.0f, ay = 0.0f, az = 0.0f;
+            stack.clear();
+            stack.push_back(0);
+            while (!stack.empty()) {
+                const OctreeNode& node = octree[stack.back()];
+                stack.pop_back();
+                if (node.body == i) continue;
+
+                float dx = node.mx - xi;
+                float dy = node.my - yi;
+                float dz = node.mz - zi;
+                float d2 = dx * dx + dy * dy + dz * dz;
+                float size = 2.0f * node.half;
+
+                // Open the cell unless it is a leaf or far enough away (size / d < theta)
+                if (node.children >= 0 && size * size >= theta2 * d2) {
+                    for (int c = 0; c < 8; c++) {
+                        if (octree[node.children + c].mass != 0.0f) stack.push_back(node.children + c);
+                    }
+                    continue;
+                }
+                float inv = 1.0f / sqrt(d2 + eps2);
+                float s = node.mass * inv * inv * inv;
+                ax += dx * s; ay += dy * s; az += dz * s;
+            }
+            bodies[i].ax = G * ax;
+            bodies[i].ay = G * ay;
+            bodies[i].az = G * az;
+        }
+    };
+    pool.run((int)bodies.size(), 64, workerCount(world.settings), job);
+    world.forcesValid = true;
+}
+
+void computeForces(PhysicsWorld& world) {
+    if (world.settings.method == FORCE_DIRECT) {
+        computeForcesDirect(world);
+    } else {
+        computeForcesBarnesHut(world);
+    }
+}
+
+// ============================================================================
+// INTEGRATION
+// ============================================================================
+
+void stepPhysics(PhysicsWorld& world) {
+    if (!world.forcesValid) computeForces(world);
+
+    const float dt = world.settings.dt;
+    const float halfDt = 0.5f * dt;
+
+    // Kick + drift
+    for (auto& b : world.bodies) {
+        b.vx += b.ax * halfDt; b.vy += b.ay * halfDt; b.vz += b.az * halfDt;
+        b.x += b.vx * dt;      b.y += b.vy * dt;      b.z += b.vz * dt;
+    }
+
+    computeForces(world);
+
+    // Kick
+    for (auto& b : world.bodies) {
+        b.vx += b.ax * halfDt; b.vy += b.ay * halfDt; b.vz += b.az * halfDt;
+    }
+}
+
+int advancePhysics(PhysicsWorld& world, double elapsedSeconds) {
+    if (!physicsRunning(world) || world.settings.dt <= 0.0f) return 0;
+
+    world.accumulator += elapsedSeconds * world.settings.timeScale;
+    int steps = 0;
+    while (world.accumulator >= world.settings.dt) {
+        if (steps >= world.settings.maxSubsteps) {
+            world.accumulator = 0.0;  // fall behind instead of spiraling
+            break;
+        }
+        stepPhysics(world);
+        world.accumulator -= world.settings.dt;
+        steps++;
+    }
+    return steps;
+}
+
+double totalEnergy(const PhysicsWorld& world) {
+    const vector<Body>& bodies = world.bodies;
+    const double eps2 = (double)world.settings.softening * world.settings.softening;
+    double kinetic = 0.0, potential = 0.0;
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const Body& a = bodies[i];
+        kinetic += 0.5 * a.mass * ((double)a.vx * a.vx + (double)a.vy * a.vy + (double)a.vz * a.vz);
+        for (size_t j = i + 1; j < bodies.size(); j++) {
+            const Body& b = bodies[j];
+            double dx = b.x - a.x, dy = b.y - a.y, dz = b.z - a.z;
+            potential -= world.settings.G * a.mass * b.mass / sqrt(dx * dx + dy * dy + dz * dz + eps2);
+        }
+    }
+    return kinetic + potential;
+}
+
+bool physicsRunning(const PhysicsWorld& world) {
+    return world.settings.enabled && !world.paused && !world.bodies.empty();
+}
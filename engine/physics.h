@@ -0,0 +1,93 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <vector>
+#include "geometry.h"
+
+using namespace std;
+
+// ============================================================================
+// N-BODY PHYSICS
+// ============================================================================
+
+enum ForceMethod { FORCE_DIRECT, FORCE_BARNES_HUT };
+
+struct Body {
+    float x, y, z;      // world-space position
+    float vx, vy, vz;   // velocity
+    float ax, ay, az;   // acceleration from the last force evaluation
+    float mass;
+};
+
+struct PhysicsSettings {
+    bool enabled;       // set by a <physics> element in the config
+    ForceMethod method;
+    float G;            // gravitational constant
+    float dt;           // fixed integration step (simulation seconds)
+    float timeScale;    // simulation seconds per real second
+    float theta;        // Barnes-Hut opening angle (0 = exact)
+    float softening;    // Plummer softening length
+    int threads;        // force threads (0 = hardware concurrency)
+    int maxSubsteps;    // steps per frame before dropping time
+    PhysicsSettings() :
+        enabled(false), method(FORCE_BARNES_HUT),
+        G(1.0f), dt(0.01f), timeScale(1.0f),
+        theta(0.5f), softening(0.1f),
+        threads(0), maxSubsteps(8) {}
+};
+
+struct PhysicsWorld {
+    PhysicsSettings settings;
+    vector<Body> bodies;
+    double accumulator;  // unsimulated time carried between frames
+    bool paused;
+    bool forcesValid;    // accelerations match the current positions
+    PhysicsWorld() : accumulator(0.0), paused(false), forcesValid(false) {}
+};
+
+/**
+ * Register a body (position is filled in later by placeBodies)
+ */
+int addBody(PhysicsWorld& world, float mass, float vx, float vy, float vz);
+
+/**
+ * Set each body's position from the world-space origin of its group
+ */
+void placeBodies(PhysicsWorld& world, const Group& root);
+
+/**
+ * Compute accelerations by direct O(n²) summation (reference)
+ */
+void computeForcesDirect(PhysicsWorld& world);
+
+/**
+ * Compute accelerations with a Barnes-Hut octree rebuilt on every call
+ */
+void computeForcesBarnesHut(PhysicsWorld& world);
+
+/**
+ * Compute accelerations with the configured method
+ */
+void computeForces(PhysicsWorld& world);
+
+/**
+ * Advance one fixed step with the kick-drift-kick leapfrog integrator
+ */
+void stepPhysics(PhysicsWorld& world);
+
+/**
+ * Advance by real elapsed time in fixed steps, returns the number of steps taken
+ */
+int advancePhysics(PhysicsWorld& world, double elapsedSeconds);
+
+/**
+ * Total kinetic + potential energy (O(n²), for checking the integrator)
+ */
+double totalEnergy(const PhysicsWorld& world);
+
+/**
+ * Whether the simulation is currently moving bodies
+ */
+bool physicsRunning(const PhysicsWorld& world);
+
+#endif // PHYSICS_H
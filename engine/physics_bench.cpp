@@ -0,0 +1,117 @@
+// ============================================================================
+// PHYSICS BENCHMARK
+// ============================================================================
+// Measures N-body steps per second against body count for Barnes-Hut and
+// direct summation, and the Barnes-Hut force error against the direct
+// reference.
+//
+// Usage: physics_bench [max_bodies] [threads] [theta]
+// ============================================================================
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include "physics.h"
+
+using namespace std;
+
+// Bodies above this count are too slow to time with direct summation
+static const int MAX_DIRECT_BODIES = 16384;
+
+/**
+ * Fill the world with a cold uniform sphere of equal-mass bodies
+ */
+static void makeCluster(PhysicsWorld& world, int n) {
+    world.bodies.clear();
+    mt19937 rng(1234);
+    uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    const float radius = 100.0f;
+    while ((int)world.bodies.size() < n) {
+        float x = unit(rng), y = unit(rng), z = unit(rng);
+        if (x * x + y * y + z * z > 1.0f) continue;
+        int i = addBody(world, 1.0f / n, unit(rng) * 0.01f, unit(rng) * 0.01f, unit(rng) * 0.01f);
+        world.bodies[i].x = x * radius;
+        world.bodies[i].y = y * radius;
+        world.bodies[i].z = z * radius;
+    }
+}
+
+/**
+ * Run steps for at least minSeconds and return steps per second
+ */
+static double measureSteps(PhysicsWorld& world, double minSeconds) {
+    stepPhysics(world);  // warm-up (builds the pool and tree storage)
+    int steps = 0;
+    auto start = chrono::steady_clock::now();
+    double elapsed = 0.0;
+    do {
+        stepPhysics(world);
+        steps++;
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    return steps / elapsed;
+}
+
+/**
+ * RMS relative error of Barnes-Hut accelerations against direct summation
+ */
+static double forceError(PhysicsWorld& world) {
+    computeForcesDirect(world);
+    vector<Body> reference = world.bodies;
+    computeForcesBarnesHut(world);
+    double sum = 0.0;
+    for (size_t i = 0; i < reference.size(); i++) {
+        const Body& r = reference[i];
+        const Body& b = world.bodies[i];
+        double dx = b.ax - r.ax, dy = b.ay - r.ay, dz = b.az - r.az;
+        double ref2 = (double)r.ax * r.ax + (double)r.ay * r.ay + (double)r.az * r.az;
+        if (ref2 > 0.0) sum += (dx * dx + dy * dy + dz * dz) / ref2;
+    }
+    return sqrt(sum / reference.size());
+}
+
+int main(int argc, char** argv) {
+    int maxBodies = argc > 1 ? atoi(argv[1]) : 32768;
+    int threads   = argc > 2 ? atoi(argv[2]) : 0;
+    float theta   = argc > 3 ? (float)atof(argv[3]) : 0.5f;
+
+    PhysicsWorld world;
+    world.settings.enabled = true;
+    world.settings.G = 1.0f;
+    world.settings.dt = 0.01f;
+    world.settings.softening = 0.5f;
+    world.settings.theta = theta;
+    world.settings.threads = threads;
+
+    cout << "bodies,barnes_hut_steps_per_s,direct_steps_per_s,speedup,bh_rms_rel_error" << endl;
+    cout << fixed;
+    for (int n = 1024; n <= maxBodies; n *= 2) {
+        makeCluster(world, n);
+        double error = forceError(world);
+
+        world.settings.method = FORCE_BARNES_HUT;
+        world.forcesValid = false;
+        double bh = measureSteps(world, 1.0);
+
+        double direct = 0.0;
+        if (n <= MAX_DIRECT_BODIES) {
+            makeCluster(world, n);
+            world.settings.method = FORCE_DIRECT;
+            world.forcesValid = false;
+            direct = measureSteps(world, 1.0);
+        }
+
+        cout << n << ","
+             << setprecision(2) << bh << ",";
+        if (direct > 0.0) {
+            cout << direct << "," << bh / direct;
+        } else {
+            cout << "-,-";
+        }
+        cout << "," << setprecision(5) << error << endl;
+    }
+    return 0;
+}
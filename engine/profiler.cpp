@@ -0,0 +1,134 @@
+#include "profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+bool frameProfiling = false;
+bool profileAlways = false;
+bool showFrameStats = false;
+FrameSample currentFrame;
+long long framesDrawn = 0;
+
+// Ring buffer of finished frames
+static FrameSample history[FRAME_HISTORY];
+static int historyNext = 0;
+static int historyCount = 0;
+
+static double frameStartMs = 0.0;
+static double lapStartMs = 0.0;
+
+static ofstream csv;
+static long long csvFrame = 0;
+
+static const char* phaseNames[PHASE_COUNT] = {
+    "update", "camera", "traversal", "state", "submit", "hud", "swap"
+};
+
+const char* framePhaseName(int phase) {
+    return phase < PHASE_COUNT ? phaseNames[phase] : "frame";
+}
+
+// ============================================================================
+// FRAME MARKERS
+// ============================================================================
+
+void profileFrameStart() {
+    currentFrame = FrameSample();
+    if (!frameProfiling && !traceEnabled()) return;
+    frameStartMs = lapStartMs = profilerClockMs();
+}
+
+void profileLap(FramePhase phase) {
+    if (!frameProfiling && !traceEnabled()) return;
+    double now = profilerClockMs();
+    currentFrame.phaseMs[phase] += now - lapStartMs;
+    traceComplete(phaseNames[phase], "frame", lapStartMs * 1000.0);
+    lapStartMs = now;
+}
+
+void profileFrameEnd() {
+    framesDrawn++;
+    traceComplete("frame", "frame", frameStartMs * 1000.0);
+    if (!frameProfiling) return;
+    currentFrame.totalMs = profilerClockMs() - frameStartMs;
+    // State changes and submission are timed inside the traversal lap
+    currentFrame.phaseMs[PHASE_TRAVERSAL] -= currentFrame.phaseMs[PHASE_STATE] + currentFrame.phaseMs[PHASE_SUBMIT];
+    if (currentFrame.phaseMs[PHASE_TRAVERSAL] < 0.0) currentFrame.phaseMs[PHASE_TRAVERSAL] = 0.0;
+
+    history[historyNext] = currentFrame;
+    historyNext = (historyNext + 1) % FRAME_HISTORY;
+    if (historyCount < FRAME_HISTORY) historyCount++;
+
+    if (csv.is_open()) {
+        csv << csvFrame++;
+        for (int p = 0; p < PHASE_COUNT; p++) csv << ',' << currentFrame.phaseMs[p];
+        csv << ',' << currentFrame.totalMs << ',' << currentFrame.models
+            << ',' << currentFrame.triangles << ',' << currentFrame.stateChanges << '\n';
+    }
+}
+
+// ============================================================================
+// CSV OUTPUT
+// ============================================================================
+
+bool openFrameCSV(const string& filename) {
+    csv.open(filename.c_str());
+    if (!csv) {
+        cerr << "Could not open frame CSV " << filename << endl;
+        return false;
+    }
+    csv << "frame";
+    for (int p = 0; p < PHASE_COUNT; p++) csv << ',' << phaseNames[p] << "_ms";
+    csv << ",total_ms,models,triangles,state_changes\n";
+    frameProfiling = true;
+    return true;
+}
+
+// ============================================================================
+// STATISTICS
+// ============================================================================
+
+const FrameSample& frameHistory(int age) {
+    return history[(historyNext - 1 - age + FRAME_HISTORY) % FRAME_HISTORY];
+}
+
+int frameHistorySize() {
+    return historyCount;
+}
+
+double percentile(const vector<double>& sorted, double p) {
+    size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > sorted.size()) rank = sorted.size();
+    return sorted[rank - 1];
+}
+
+FrameTimeStats frameTimeStats(int phase) {
+    FrameTimeStats stats = FrameTimeStats();
+    if (historyCount == 0) return stats;
+
+    vector<double> samples(historyCount);
+    double sum = 0.0;
+    for (int i = 0; i < historyCount; i++) {
+        samples[i] = phase < PHASE_COUNT ? history[i].phaseMs[phase] : history[i].totalMs;
+        sum += samples[i];
+    }
+    sort(samples.begin(), samples.end());
+    stats.frames = historyCount;
+    stats.min = samples.front();
+    stats.avg = sum / historyCount;
+    stats.p50 = percentile(samples, 50);
+    stats.p95 = percentile(samples, 95);
+    stats.p99 = percentile(samples, 99);
+    stats.max = samples.back();
+    return stats;
+}
+
+void toggleFrameStats() {
+    showFrameStats = !showFrameStats;
+    frameProfiling = showFrameStats || csv.is_open() || profileAlways;
+    cout << "→ Frame stats: " << (showFrameStats ? "ON ✓" : "OFF ✗") << endl;
+}
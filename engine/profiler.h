@@ -0,0 +1,101 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <vector>
+#include "../include/trace.h"
+
+using namespace std;
+
+// ============================================================================
+// FRAME PROFILER
+// ============================================================================
+
+// Times each phase of a frame with the steady clock and keeps the last
+// FRAME_HISTORY frames for the overlay (key T) and the CSV stream
+// (--frame-csv). Counters are always kept; phase timing only runs while
+// frameProfiling is on, since it reads the clock around every model. While
+// tracing, each phase and frame is also recorded as a trace event.
+
+enum FramePhase {
+    PHASE_UPDATE,     // pending reload, FPS counter, physics step
+    PHASE_CAMERA,     // clear, camera and view state
+    PHASE_TRAVERSAL,  // scene graph walk and matrix calls
+    PHASE_STATE,      // color and face-culling changes
+    PHASE_SUBMIT,     // vertex submission (glBegin/glEnd)
+    PHASE_HUD,        // overlay text and graph
+    PHASE_SWAP,       // buffer swap (glFinish in benchmarks)
+    PHASE_COUNT
+};
+
+const int FRAME_HISTORY = 240;
+
+struct FrameSample {
+    double phaseMs[PHASE_COUNT];
+    double totalMs;
+    int models;            // models drawn
+    long long triangles;   // triangles submitted
+    int stateChanges;      // color and culling calls
+};
+
+struct FrameTimeStats {
+    int frames;  // samples in the window
+    double min, avg, p50, p95, p99, max;
+};
+
+extern bool frameProfiling;   // time phases (overlay shown, CSV open or profileAlways)
+extern bool profileAlways;    // keep timing with the overlay off (stats endpoint)
+extern bool showFrameStats;   // draw the overlay
+extern FrameSample currentFrame;  // frame being drawn
+extern long long framesDrawn;     // frames finished since start
+
+// Same clock as the trace events
+inline double profilerClockMs() {
+    return traceNowUs() / 1000.0;
+}
+
+/**
+ * Start a frame: reset the counters and the phase clock
+ */
+void profileFrameStart();
+
+/**
+ * Charge the time since the previous lap (or frame start) to a phase
+ */
+void profileLap(FramePhase phase);
+
+/**
+ * Finish a frame: store it in the history and write its CSV row
+ */
+void profileFrameEnd();
+
+/**
+ * Stream one row per frame to a CSV file; returns false if it can't be opened
+ */
+bool openFrameCSV(const string& filename);
+
+/**
+ * Statistics of one phase (or of the whole frame with PHASE_COUNT) over
+ * the frames in the history
+ */
+FrameTimeStats frameTimeStats(int phase);
+
+/**
+ * Nearest-rank percentile (p in 0..100) of sorted, non-empty samples
+ */
+double percentile(const vector<double>& sorted, double p);
+
+/**
+ * Frame at a given age (0 = last finished frame); age < frameHistorySize()
+ */
+const FrameSample& frameHistory(int age);
+int frameHistorySize();
+
+const char* framePhaseName(int phase);
+
+/**
+ * Toggle the overlay (key T)
+ */
+void toggleFrameStats();
+
+#endif // PROFILER_H
@@ -0,0 +1,359 @@
+#include "reload.h"
+#include "config.h"
+#include "model.h"
+#include "scheduler.h"
+#include "memory.h"
+#include "../include/trace.h"
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <map>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+
+using namespace std;
+
+// How often the GLUT thread checks whether the loader has finished
+static const unsigned int RELOAD_POLL_MS = 10;
+
+// Patches copy into the live arena, which never frees: once they add more
+// than this (or more than a fresh graph takes) the re-parsed scene is swapped in
+static const size_t RELOAD_PATCH_ARENA_BYTES = 256 * 1024;
+
+// Result of a background load, waiting for the next frame boundary
+struct PendingReload {
+    shared_ptr<Scene> scene;      // re-parsed config (null if only meshes changed)
+    bool incremental;             // patch the live scene when the tree shape allows it
+    map<string, MeshPtr> meshes;  // re-read figure files
+    PendingReload() : incremental(false) {}
+};
+
+thread loaderThread;
+thread releaseThread;  // frees what the last swap replaced
+atomic<bool> loaderBusy(false);
+mutex pendingLock;
+bool pendingReady = false;
+PendingReload pending;
+chrono::steady_clock::time_point reloadStart;
+int sceneGeneration = 0;
+
+// ============================================================================
+// LOADER THREAD
+// ============================================================================
+
+static void loadInBackground(string file, bool configChanged, bool incremental,
+                             vector<string> changedModels) {
+    TraceScope trace("reload", "reload", file.c_str());
+    PendingReload result;
+    result.incremental = incremental;
+
+    // Force a re-read first so the re-parsed config picks up the new meshes too
+    for (const auto& model : changedModels) {
+        result.meshes[model] = reloadModel(model);
+    }
+
+    bool ok = true;
+    if (configChanged) {
+        result.scene = make_shared<Scene>();
+        ok = loadScene(file.c_str(), *result.scene);
+    }
+
+    if (ok) {
+        lock_guard<mutex> guard(pendingLock);
+        pending = result;
+        pendingReady = true;
+    } else {
+        cerr << "Reload failed, keeping the current scene" << endl;
+    }
+    loaderBusy = false;
+}
+
+/**
+ * GLUT is not thread-safe, so the loader cannot post a redisplay itself;
+ * instead the GLUT thread polls on a timer until the scene is ready.
+ */
+static void pollReload(int) {
+    bool busy = loaderBusy;  // read first: the loader publishes its result before clearing it
+    bool ready;
+    {
+        lock_guard<mutex> guard(pendingLock);
+        ready = pendingReady;
+    }
+    if (ready) {
+        requestRedraw();
+    } else if (busy) {
+        glutTimerFunc(RELOAD_POLL_MS, pollReload, 0);
+    }
+}
+
+/**
+ * exit() destroys a joinable std::thread by calling terminate, and the
+ * release thread must not outlive the model cache it prunes: both are
+ * joined before static destructors run
+ */
+static void joinReloadThreads() {
+    if (loaderThread.joinable()) loaderThread.join();
+    if (releaseThread.joinable()) releaseThread.join();
+}
+
+static void startLoader(bool configChanged, bool incremental, const vector<string>& changedModels) {
+    static bool joinAtExit = false;
+    if (!joinAtExit) {
+        atexit(joinReloadThreads);
+        joinAtExit = true;
+    }
+    if (loaderThread.joinable()) loaderThread.join();
+    reloadStart = chrono::steady_clock::now();
+    loaderBusy = true;
+    loaderThread = thread(loadInBackground, currentConfigFile, configChanged, incremental, changedModels);
+    glutTimerFunc(RELOAD_POLL_MS, pollReload, 0);
+}
+
+// ============================================================================
+// IN-PLACE PATCHING
+// ============================================================================
+
+struct PatchStats {
+    int transforms;
+    int models;
+    int meshes;
+    PatchStats() : transforms(0), models(0), meshes(0) {}
+};
+
+// Live prototype matching each prototype of the fresh scene
+typedef map<const Group*, const Group*> PrototypeMap;
+
+/**
+ * Two trees can be patched in place if they have the same groups, bodies and
+ * instances; transforms, models and which prototype is used may differ.
+ */
+static bool sameShape(const Group& live, const Group& fresh) {
+    if (live.children.size() != fresh.children.size()) return false;
+    if ((live.body >= 0) != (fresh.body >= 0)) return false;
+    if ((live.instance != nullptr) != (fresh.instance != nullptr)) return false;
+    auto it = fresh.children.begin();
+    for (const auto& child : live.children) {
+        if (!sameShape(child, *it++)) return false;
+    }
+    return true;
+}
+
+static bool sameTransform(const Transform& a, const Transform& b) {
+    return a.type == b.type && a.x == b.x && a.y == b.y && a.z == b.z &&
+           (a.type != ROTATE || a.angle == b.angle);
+}
+
+static bool sameTransforms(const pmr::list<Transform>& a, const pmr::list<Transform>& b) {
+    if (a.size() != b.size()) return false;
+    auto it = b.begin();
+    for (const auto& t : a) {
+        if (!sameTransform(t, *it++)) return false;
+    }
+    return true;
+}
+
+static bool sameMatrix(const Group& a, const Group& b) {
+    return a.hasMatrix == b.hasMatrix &&
+           (!a.hasMatrix || memcmp(a.matrix.m, b.matrix.m, sizeof(a.matrix.m)) == 0);
+}
+
+static bool sameModel(const Model& a, const Model& b) {
+    return a.file == b.file && a.mesh == b.mesh &&
+           a.r == b.r && a.g == b.g && a.b == b.b && a.cull == b.cull;
+}
+
+/**
+ * Patch changed parts of the live tree. The trees live in different arenas,
+ * so changed lists are copied into the live arena (the old nodes go with it
+ * when the scene is dropped); replaced meshes are kept in retired so they
+ * are freed off the render thread.
+ */
+static void patchGroup(Group& live, const Group& fresh, const PrototypeMap& prototypes,
+                       vector<MeshPtr>& retired, PatchStats& stats) {
+    if (fresh.instance) {
+        live.instance = prototypes.at(fresh.instance);
+    }
+
+    if (!sameTransforms(live.transforms, fresh.transforms)) {
+        live.transforms = fresh.transforms;
+        stats.transforms++;
+    }
+    if (!sameMatrix(live, fresh)) {
+        live.hasMatrix = fresh.hasMatrix;
+        live.matrix = fresh.matrix;
+        stats.transforms++;
+    }
+
+    if (live.models.size() != fresh.models.size()) {
+        for (const auto& m : live.models) retired.push_back(m.mesh);
+        live.models = fresh.models;
+        stats.models++;
+    } else {
+        auto it = fresh.models.begin();
+        for (auto& m : live.models) {
+            if (!sameModel(m, *it)) {
+                retired.push_back(m.mesh);
+                m = *it;
+                stats.models++;
+            }
+            ++it;
+        }
+    }
+
+    auto it = fresh.children.begin();
+    for (auto& child : live.children) {
+        patchGroup(child, *it++, prototypes, retired, stats);
+    }
+}
+
+/**
+ * Point models at re-read meshes (the old ones are kept in retired)
+ */
+static void swapMeshes(Group& g, const map<string, MeshPtr>& meshes,
+                       vector<MeshPtr>& retired, PatchStats& stats) {
+    for (auto& m : g.models) {
+        auto it = meshes.find(m.file);
+        if (it != meshes.end() && m.mesh != it->second) {
+            retired.push_back(m.mesh);
+            m.mesh = it->second;
+            stats.meshes++;
+        }
+    }
+    for (auto& child : g.children) {
+        swapMeshes(child, meshes, retired, stats);
+    }
+}
+
+/**
+ * Patch the whole scene: prototypes first, then the tree that instances them
+ */
+static bool patchScene(Scene& live, const Scene& fresh, vector<MeshPtr>& retired, PatchStats& stats) {
+    if (live.prototypes.size() != fresh.prototypes.size()) return false;
+    if (!sameShape(live.root, fresh.root)) return false;
+    PrototypeMap prototypes;
+    auto it = live.prototypes.begin();
+    for (const auto& prototype : fresh.prototypes) {
+        if (!sameShape(*it, prototype)) return false;
+        prototypes[&prototype] = &*it++;
+    }
+
+    it = live.prototypes.begin();
+    for (const auto& prototype : fresh.prototypes) {
+        patchGroup(*it++, prototype, prototypes, retired, stats);
+    }
+    patchGroup(live.root, fresh.root, prototypes, retired, stats);
+    return true;
+}
+
+/**
+ * Keep the running simulation, but take the new settings and masses
+ */
+static void patchPhysics(PhysicsWorld& live, const PhysicsWorld& fresh) {
+    bool paused = live.paused;
+    live.settings = fresh.settings;
+    live.paused = paused;
+    for (size_t i = 0; i < live.bodies.size() && i < fresh.bodies.size(); i++) {
+        live.bodies[i].mass = fresh.bodies[i].mass;
+    }
+    live.forcesValid = false;
+}
+
+// ============================================================================
+// RELOAD CONTROL
+// ============================================================================
+
+void reloadConfig() {
+    if (reloadInProgress()) {
+        cout << "Reload already in progress" << endl;
+        return;
+    }
+    cout << "Reloading configuration in the background..." << endl;
+    startLoader(true, false, vector<string>());
+}
+
+bool reloadChanged(bool configChanged, const vector<string>& changedModels) {
+    if (reloadInProgress()) return false;
+    if (!configChanged && changedModels.empty()) return true;
+    startLoader(configChanged, true, changedModels);
+    return true;
+}
+
+void applyPendingReload() {
+    PendingReload result;
+    {
+        lock_guard<mutex> guard(pendingLock);
+        if (!pendingReady) return;
+        result = pending;
+        pending = PendingReload();
+        pendingReady = false;
+    }
+    // The loader published its result and is returning
+    if (loaderThread.joinable()) loaderThread.join();
+
+    PatchStats stats;
+    Scene& live = *activeScene;
+    bool patched = false;
+    bool compacted = false;
+    vector<MeshPtr> retired;
+
+    size_t arenaBefore = live.arena.bytes;
+    if (result.scene && result.incremental &&
+        live.physics.bodies.size() == result.scene->physics.bodies.size() &&
+        patchScene(live, *result.scene, retired, stats)) {
+        patchPhysics(live.physics, result.scene->physics);
+        patched = true;
+        live.patchedBytes += live.arena.bytes - arenaBefore;
+        // The fresh tree now matches the patched one: swap it in with the
+        // running simulation, keeping the window and camera as a patch does
+        if (live.patchedBytes > max(RELOAD_PATCH_ARENA_BYTES, result.scene->arena.bytes)) {
+            result.scene->physics = live.physics;
+            shared_ptr<Scene> patchedScene = activeScene;
+            activeScene = result.scene;
+            result.scene = patchedScene;
+            compacted = true;
+        }
+    } else if (!result.scene) {
+        swapMeshes(live.root, result.meshes, retired, stats);
+        for (auto& prototype : live.prototypes) {
+            swapMeshes(prototype, result.meshes, retired, stats);
+        }
+        patched = true;
+    }
+
+    // Free whatever was replaced off the render thread, then forget unused meshes
+    shared_ptr<Scene> old = patched ? result.scene : activeScene;
+    if (!patched) applyScene(result.scene);
+    sceneGeneration++;
+    result = PendingReload();
+    if (releaseThread.joinable()) releaseThread.join();
+    releaseThread = thread([old, retired]() mutable {
+        old.reset();
+        retired.clear();
+        pruneModelCache();
+        markMemory("released");
+    });
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - reloadStart).count();
+    if (patched) {
+        cout << "Scene patched in place: " << stats.transforms << " transform lists, "
+             << stats.models << " models, " << stats.meshes << " meshes ("
+             << ms << " ms" << (compacted ? ", swapped in a fresh scene graph" : "") << ")" << endl;
+    } else {
+        cout << "Configuration reloaded! (" << ms << " ms)" << endl;
+    }
+}
+
+bool reloadInProgress() {
+    if (loaderBusy) return true;
+    lock_guard<mutex> guard(pendingLock);
+    return pendingReady;
+}
@@ -0,0 +1,39 @@
+#ifndef RELOAD_H
+#define RELOAD_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+extern int sceneGeneration;  // bumped whenever a reload changes the live scene
+
+// ============================================================================
+// BACKGROUND RELOAD
+// ============================================================================
+
+/**
+ * Start reloading the current configuration on a background thread.
+ * The old scene keeps rendering until the new one is ready.
+ */
+void reloadConfig();
+
+/**
+ * Reload only what changed on disk: the config is re-parsed and patched into
+ * the live scene when its group tree has the same shape, and changed figure
+ * files are re-read and swapped into the models using them.
+ * Returns false if another reload is still running (try again later).
+ */
+bool reloadChanged(bool configChanged, const vector<string>& changedModels);
+
+/**
+ * Swap in a finished reload (called at the frame boundary, GLUT thread only)
+ */
+void applyPendingReload();
+
+/**
+ * Whether a reload is loading or waiting to be swapped in
+ */
+bool reloadInProgress();
+
+#endif // RELOAD_H
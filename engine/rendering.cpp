@@ -1,9 +1,17 @@
 #include "rendering.h"
+#include "physics.h"
+#include "matrix.h"
+#include "scheduler.h"
+#include "reload.h"
+#include "profiler.h"
+#include "camerapath.h"
+#include "analysis.h"
 #include <iostream>
 #include <cmath>
 #include <vector>
 #include <cstdlib>
 #include <string>
+#include <cstdio>
 
 #ifdef __APPLE__
 #include <GLUT/glut.h>
@@ -13,6 +21,26 @@
 
 using namespace std;
 
+// ============================================================================
+// FRAME CLOCK
+// ============================================================================
+
+// Milliseconds added per frame when frames are not driven by GLUT (0 = real time)
+double fixedFrameStep = 0.0;
+double fixedClock = 1000.0;
+
+void setFixedFrameStep(double ms) {
+    fixedFrameStep = ms;
+}
+
+/**
+ * Animation time in ms: GLUT's clock, or a fixed step per frame
+ */
+static unsigned long frameTimeMs() {
+    if (fixedFrameStep > 0.0) return (unsigned long)fixedClock;
+    return glutGet(GLUT_ELAPSED_TIME);
+}
+
 // ============================================================================
 // FPS COUNTER
 // ============================================================================
@@ -22,7 +50,7 @@ unsigned long lastTime = 0;
 
 void updateFPS() {
     frameCount++;
-    unsigned long currentTime = glutGet(GLUT_ELAPSED_TIME);
+    unsigned long currentTime = frameTimeMs();
     if (currentTime - lastTime >= 1000) {  // Update every 1 second
         fps = frameCount * 1000.0f / (currentTime - lastTime);
         frameCount = 0;
@@ -30,36 +58,109 @@ void updateFPS() {
     }
 }
 
+// ============================================================================
+// PHYSICS UPDATE
+// ============================================================================
+
+unsigned long lastPhysicsTime = 0;
+float viewMatrix[16];  // camera matrix, restored for bodies simulated in world space
+
+void updatePhysics() {
+    unsigned long currentTime = frameTimeMs();
+    if (lastPhysicsTime == 0) lastPhysicsTime = currentTime;
+    advancePhysics(activeScene->physics, (currentTime - lastPhysicsTime) / 1000.0);
+    lastPhysicsTime = currentTime;
+}
+
 // ============================================================================
 // GROUP RENDERING
 // ============================================================================
 
-void renderGroup(const Group& g) {
+// Color and culling state as last set while drawing the scene, so models
+// that share state do not repeat the GL calls
+struct RenderState {
+    bool haveColor;
+    float r, g, b;
+    bool culling;
+};
+RenderState renderState;
+
+void renderGroup(const Group& g, const Mat4& inherited) {
     glPushMatrix();
 
+    // Simulated bodies live in world space: their position replaces the
+    // inherited matrix and their own translations, but the rotation and
+    // scale of the chain above them still apply (as in placeBodies)
+    const PhysicsWorld& physics = activeScene->physics;
+    bool simulated = g.body >= 0 && physics.settings.enabled;
+    bool trackLinear = physics.settings.enabled && !physics.bodies.empty();
+    Mat4 linear = inherited;
+    if (simulated) {
+        const Body& b = physics.bodies[g.body];
+        glLoadMatrixf(viewMatrix);
+        glTranslatef(b.x, b.y, b.z);
+        if (!mat4IsIdentity(inherited)) glMultMatrixf(inherited.m);
+    }
+
+    if (g.hasMatrix) {
+        glMultMatrixf(g.matrix.m);  // for bodies this already leaves out the translations
+        if (trackLinear) linear = mat4Multiply(linear, mat4Linear(g.matrix));
+    }
     for (const auto& t : g.transforms) {
         if (t.type == TRANSLATE) {
+            if (simulated) continue;
             glTranslatef(t.x, t.y, t.z);
         } else if (t.type == ROTATE) {
             glRotatef(t.angle, t.x, t.y, t.z);
+            if (trackLinear) mat4Apply(linear, t);
         } else if (t.type == SCALE) {
             glScalef(t.x, t.y, t.z);
+            if (trackLinear) mat4Apply(linear, t);
         }
     }
 
     for (const auto& m : g.models) {
-        if (!m.cull) glDisable(GL_CULL_FACE);
-        glColor3f(m.r, m.g, m.b);
+        double stateStart = frameProfiling ? profilerClockMs() : 0.0;
+        bool culling = m.cull && enableCulling;
+        if (culling != renderState.culling) {
+            if (culling) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+            renderState.culling = culling;
+            currentFrame.stateChanges++;
+        }
+        if (analysisColors) {
+            setAnalysisModelColor(g, m);
+            renderState.haveColor = false;
+        } else if (!renderState.haveColor || m.r != renderState.r || m.g != renderState.g || m.b != renderState.b) {
+            glColor3f(m.r, m.g, m.b);
+            renderState.haveColor = true;
+            renderState.r = m.r;
+            renderState.g = m.g;
+            renderState.b = m.b;
+            currentFrame.stateChanges++;
+        }
+        double submitStart = frameProfiling ? profilerClockMs() : 0.0;
         glBegin(GL_TRIANGLES);
-        for (const auto& v : m.vertices) {
-            glVertex3f(v.x, v.y, v.z);
+        const Vertex* v = m.mesh->vertices;
+        for (size_t i = 0; i < m.mesh->vertexCount; i++) {
+            glVertex3f(v[i].x, v[i].y, v[i].z);
         }
         glEnd();
-        if (!m.cull && enableCulling) glEnable(GL_CULL_FACE);
+        if (frameProfiling) {
+            double submitEnd = profilerClockMs();
+            currentFrame.phaseMs[PHASE_STATE] += submitStart - stateStart;
+            currentFrame.phaseMs[PHASE_SUBMIT] += submitEnd - submitStart;
+        }
+        currentFrame.models++;
+        currentFrame.triangles += m.mesh->vertexCount / 3;
     }
 
     for (const auto& child : g.children) {
-        renderGroup(child);
+        renderGroup(child, linear);
+    }
+
+    // Instance of a <define>: the shared subtree is drawn under this group's transform
+    if (g.instance) {
+        renderGroup(*g.instance, linear);
     }
 
     glPopMatrix();
@@ -69,6 +170,27 @@ void renderGroup(const Group& g) {
 // MAIN RENDERING
 // ============================================================================
 
+/**
+ * Draw the scene graph from a clean render state and leave culling as the toggle says
+ */
+static void drawSceneGraph() {
+    if (enableCulling) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+    renderState.haveColor = false;
+    renderState.culling = enableCulling;
+    renderGroup(activeScene->root);
+    if (renderState.culling != enableCulling) {
+        if (enableCulling) glEnable(GL_CULL_FACE); else glDisable(GL_CULL_FACE);
+    }
+}
+
+void setupGL() {
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glClearColor(0.02f, 0.02f, 0.08f, 1.0f);
+}
+
 void changeSize(int w, int h) {
     if (h == 0) h = 1;
     float ratio = w * 1.0 / h;
@@ -79,14 +201,82 @@ void changeSize(int w, int h) {
     glMatrixMode(GL_MODELVIEW);
 }
 
-void renderScene(void) {
+// ============================================================================
+// OVERLAY
+// ============================================================================
+
+static void drawText(int x, int y, const char* text) {
+    glRasterPos2i(x, y);
+    for (const char* c = text; *c; c++) {
+        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, *c);
+    }
+}
+
+/**
+ * Per-phase statistics over the history, the frame counters and a graph of
+ * recent frame times (lines at 16.7 and 33.3 ms)
+ */
+static void drawFrameStats() {
+    char line[160];
+    int y = windowHeight - 60;
+
+    FrameTimeStats total = frameTimeStats(PHASE_COUNT);
+    snprintf(line, sizeof(line), "frame ms (last %d)   min %.2f  avg %.2f  p95 %.2f  p99 %.2f",
+             total.frames, total.min, total.avg, total.p95, total.p99);
+    drawText(10, y, line);
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        FrameTimeStats s = frameTimeStats(p);
+        y -= 16;
+        snprintf(line, sizeof(line), "  %-10s  min %.2f  avg %.2f  p95 %.2f  p99 %.2f",
+                 framePhaseName(p), s.min, s.avg, s.p95, s.p99);
+        drawText(10, y, line);
+    }
+    if (frameHistorySize() > 0) {
+        const FrameSample& last = frameHistory(0);
+        y -= 16;
+        snprintf(line, sizeof(line), "models %d  triangles %lld  state changes %d",
+                 last.models, last.triangles, last.stateChanges);
+        drawText(10, y, line);
+    }
+
+    // One bar per frame, newest on the right; 2 px per ms, clipped at 50 ms
+    const int graphHeight = 100;
+    const float pxPerMs = 2.0f;
+    int graphX = 10;
+    int graphY = y - 16 - graphHeight;
+    glBegin(GL_LINES);
+    glColor3f(0.4f, 0.4f, 0.4f);
+    for (float ms = 1000.0f / 60.0f; ms < 50.0f; ms *= 2.0f) {
+        glVertex2f(graphX, graphY + ms * pxPerMs);
+        glVertex2f(graphX + FRAME_HISTORY, graphY + ms * pxPerMs);
+    }
+    for (int age = 0; age < frameHistorySize(); age++) {
+        float ms = (float)frameHistory(age).totalMs;
+        if (ms > 1000.0f / 30.0f) glColor3f(1.0f, 0.3f, 0.3f);
+        else if (ms > 1000.0f / 60.0f) glColor3f(1.0f, 0.8f, 0.3f);
+        else glColor3f(0.3f, 1.0f, 0.3f);
+        float x = graphX + FRAME_HISTORY - age;
+        glVertex2f(x, graphY);
+        glVertex2f(x, graphY + min(ms * pxPerMs, (float)graphHeight));
+    }
+    glEnd();
+    glColor3f(1.0f, 1.0f, 1.0f);
+}
+
+void drawFrame() {
+    profileFrameStart();
+    if (fixedFrameStep > 0.0) fixedClock += fixedFrameStep;
+    applyPendingReload();  // frame boundary: swap in a finished background reload
     updateFPS();  // Update FPS
-    entityCount = 0;  // Reset entity count per frame
+    updatePhysics();
+    profileLap(PHASE_UPDATE);
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glLoadIdentity();
 
-    if (!freeCamera) {
+    if (cameraReplayActive()) {
+        applyCameraReplayFrame(camera);  // the replayed view replaces the camera update
+    } else if (!freeCamera) {
         camera.posX = sin(camera.angleAlfa * M_PI / 180.0f) * cos(camera.angleBeta * M_PI / 180.0f) * camera.radius;
         camera.posZ = cos(camera.angleAlfa * M_PI / 180.0f) * cos(camera.angleBeta * M_PI / 180.0f) * camera.radius;
         camera.posY = sin(camera.angleBeta * M_PI / 180.0f) * camera.radius;
@@ -107,6 +297,18 @@ void renderScene(void) {
     gluLookAt(camera.posX, camera.posY, camera.posZ, 
               camera.lookAtX, camera.lookAtY, camera.lookAtZ,
               camera.upX, camera.upY, camera.upZ);
+    glGetFloatv(GL_MODELVIEW_MATRIX, viewMatrix);
+    recordCameraFrame(camera);
+
+    // Coverage for the density view and the cost report: an extra draw that
+    // doesn't count towards the frame's models and triangles
+    if (coveragePassNeeded()) {
+        FrameSample counted = currentFrame;
+        beginCoveragePass();
+        drawSceneGraph();
+        endCoveragePass();
+        currentFrame = counted;
+    }
 
     // Draw axes (only if showAxes is true)
     if (showAxes) {
@@ -134,7 +336,13 @@ void renderScene(void) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
 
-    renderGroup(rootGroup);
+    profileLap(PHASE_CAMERA);
+
+    beginAnalysisPass();
+    drawSceneGraph();
+    endAnalysisPass();
+    entityCount = currentFrame.models;
+    profileLap(PHASE_TRAVERSAL);
 
     // Render text for FPS and entity count
     glMatrixMode(GL_PROJECTION);
@@ -148,19 +356,21 @@ void renderScene(void) {
     glColor3f(1.0f, 1.0f, 1.0f);  // White text
 
     if (showFPS) {
-        glRasterPos2i(10, windowHeight - 20);
         string fpsText = "FPS: " + to_string((int)fps);
-        for (char c : fpsText) {
-            glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
-        }
+        drawText(10, windowHeight - 20, fpsText.c_str());
     }
 
     if (showEntityCount) {
-        glRasterPos2i(10, windowHeight - 40);
         string countText = "Entidades: " + to_string(entityCount);
-        for (char c : countText) {
-            glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
-        }
+        drawText(10, windowHeight - 40, countText.c_str());
+    }
+
+    if (showFrameStats) drawFrameStats();
+
+    string legend = showFPS ? analysisLegend() : "";
+    if (!legend.empty()) {
+        glColor3f(1.0f, 1.0f, 1.0f);
+        drawText(10, 10, legend.c_str());
     }
 
     glEnable(GL_DEPTH_TEST);
@@ -168,6 +378,21 @@ void renderScene(void) {
     glPopMatrix();
     glMatrixMode(GL_MODELVIEW);
     glPopMatrix();
+    profileLap(PHASE_HUD);
+}
 
+void renderScene(void) {
+    beginFrame();
+    drawFrame();
     glutSwapBuffers();
+    profileLap(PHASE_SWAP);
+    profileFrameEnd();
+    if (cameraReplayActive()) {
+        cameraReplayFrameDone();
+        if (!cameraReplayActive()) {
+            printCameraReplaySummary();
+            exit(0);
+        }
+    }
+    endFrame();
 }
@@ -2,6 +2,7 @@
 #define RENDERING_H
 
 #include "geometry.h"
+#include "scene.h"
 
 // ============================================================================
 // RENDERING FLAGS AND STATE
@@ -19,7 +20,6 @@ extern int windowWidth;
 extern int windowHeight;
 extern Camera camera;
 extern bool freeCamera;
-extern Group rootGroup;
 
 // ============================================================================
 // RENDERING FUNCTIONS
@@ -36,15 +36,40 @@ void generateStars();
 void renderStars();
 
 /**
- * Render a group and its children recursively
+ * Advance the physics simulation by the real time since the last frame
  */
-void renderGroup(const Group& g);
+void updatePhysics();
 
 /**
- * Main rendering function (called every frame)
+ * Render a group and its children recursively. inherited is the rotation
+ * and scale of the ancestors (kept while physics runs): a simulated body
+ * replaces the inherited matrix by its world position, then applies it.
+ */
+void renderGroup(const Group& g, const Mat4& inherited = Mat4());
+
+/**
+ * Draw one frame into the current context without swapping buffers (the
+ * caller finishes the profiled frame with profileLap(PHASE_SWAP) and
+ * profileFrameEnd())
+ */
+void drawFrame();
+
+/**
+ * GLUT display callback: draw a frame, swap and schedule the next one
  */
 void renderScene(void);
 
+/**
+ * Fixed GL state shared by every context (depth test, culling, clear color)
+ */
+void setupGL();
+
+/**
+ * Advance animation by a fixed step per frame instead of real time
+ * (ms per frame, 0 = real time)
+ */
+void setFixedFrameStep(double ms);
+
 /**
  * Handle window resize
  */
@@ -0,0 +1,39 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <memory>
+#include <string>
+#include "arena.h"
+#include "geometry.h"
+#include "physics.h"
+
+using namespace std;
+
+// ============================================================================
+// SCENE
+// ============================================================================
+
+// Everything loaded from one config file. A reload builds a new Scene on a
+// background thread and swaps it in between frames. The scene graph is
+// allocated from the scene's arena, so dropping a scene frees it in one go.
+struct Scene {
+    string file;
+    Arena arena;  // declared before root: it must outlive the tree
+    Group root;
+    pmr::list<Group> prototypes;  // <define> subtrees, shared by instance groups
+    PhysicsWorld physics;
+    size_t patchedBytes;  // arena bytes added by in-place reload patches (never reused)
+
+    // Window and camera settings from the config (applied on load)
+    bool hasWindow;
+    int windowWidth, windowHeight;
+    bool hasCamera;
+    Camera camera;
+    vector<CameraPath> cameraPaths;
+
+    Scene() : root(&arena), prototypes(&arena), patchedBytes(0), hasWindow(false), windowWidth(800), windowHeight(600), hasCamera(false) {}
+};
+
+extern shared_ptr<Scene> activeScene;
+
+#endif // SCENE_H
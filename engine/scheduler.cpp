@@ -0,0 +1,120 @@
+#include "scheduler.h"
+#include "scene.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+
+using namespace std;
+
+FrameMode frameMode = FRAME_ON_DEMAND;
+float targetFPS = 60.0f;
+
+// A redisplay has been posted to GLUT and not drawn yet
+bool redisplayPosted = false;
+// A pacing timer is pending; it will post the redisplay when it fires
+bool pacingTimerArmed = false;
+chrono::steady_clock::time_point lastFrameStart;
+
+// ============================================================================
+// PACING
+// ============================================================================
+
+static double secondsSinceLastFrame() {
+    return chrono::duration<double>(chrono::steady_clock::now() - lastFrameStart).count();
+}
+
+static void postRedisplay() {
+    redisplayPosted = true;
+    glutPostRedisplay();
+}
+
+static void onPacingTimer(int) {
+    pacingTimerArmed = false;
+    postRedisplay();
+}
+
+static void idleRedisplay() {
+    postRedisplay();
+}
+
+/**
+ * Post the next frame now, or arm a timer for the next frame slot. GLUT
+ * sleeps in its event wait until then, so pacing costs no CPU.
+ */
+static void scheduleFrame(bool immediate) {
+    if (redisplayPosted || pacingTimerArmed) return;  // already coming
+    double wait = immediate ? 0.0 : 1.0 / targetFPS - secondsSinceLastFrame();
+    if (wait <= 0.0) {
+        postRedisplay();
+    } else {
+        pacingTimerArmed = true;
+        glutTimerFunc((unsigned int)ceil(wait * 1000.0), onPacingTimer, 0);
+    }
+}
+
+// ============================================================================
+// FRAME HOOKS
+// ============================================================================
+
+void initScheduler() {
+    lastFrameStart = chrono::steady_clock::now();
+    setFrameMode(frameMode);
+}
+
+void requestRedraw() {
+    if (frameMode == FRAME_UNCAPPED) return;  // the idle loop draws anyway
+    // Input in on-demand mode is drawn right away; capped mode keeps its cadence
+    scheduleFrame(frameMode == FRAME_ON_DEMAND);
+}
+
+void beginFrame() {
+    redisplayPosted = false;
+    lastFrameStart = chrono::steady_clock::now();
+}
+
+void endFrame() {
+    if (frameMode == FRAME_CAPPED || (frameMode == FRAME_ON_DEMAND && sceneAnimating())) {
+        scheduleFrame(false);
+    }
+}
+
+// ============================================================================
+// MODE SELECTION
+// ============================================================================
+
+void setFrameMode(FrameMode mode) {
+    frameMode = mode;
+    glutIdleFunc(mode == FRAME_UNCAPPED ? idleRedisplay : NULL);
+    scheduleFrame(true);
+}
+
+void cycleFrameMode() {
+    setFrameMode((FrameMode)((frameMode + 1) % 3));
+}
+
+bool parseFrameMode(const char* name, FrameMode& mode) {
+    if (strcmp(name, "on-demand") == 0) mode = FRAME_ON_DEMAND;
+    else if (strcmp(name, "capped") == 0) mode = FRAME_CAPPED;
+    else if (strcmp(name, "uncapped") == 0) mode = FRAME_UNCAPPED;
+    else return false;
+    return true;
+}
+
+const char* frameModeName(FrameMode mode) {
+    switch (mode) {
+        case FRAME_ON_DEMAND: return "on-demand";
+        case FRAME_CAPPED:    return "capped";
+        case FRAME_UNCAPPED:  return "uncapped";
+    }
+    return "?";
+}
+
+bool sceneAnimating() {
+    return physicsRunning(activeScene->physics);
+}
@@ -0,0 +1,62 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+// ============================================================================
+// FRAME SCHEDULER
+// ============================================================================
+
+enum FrameMode {
+    FRAME_ON_DEMAND,  // redraw only on input, reload or running animation
+    FRAME_CAPPED,     // redraw continuously at targetFPS
+    FRAME_UNCAPPED    // redraw as fast as possible (benchmarking)
+};
+
+extern FrameMode frameMode;
+extern float targetFPS;
+
+/**
+ * Apply the current frame mode to the GLUT loop (call after window creation)
+ */
+void initScheduler();
+
+/**
+ * Ask for a new frame; repeated requests before the frame is drawn are merged
+ */
+void requestRedraw();
+
+/**
+ * Mark the start of a frame (called at the top of renderScene)
+ */
+void beginFrame();
+
+/**
+ * Mark the end of a frame and schedule the next one if the scene is animating
+ */
+void endFrame();
+
+/**
+ * Change the frame mode at runtime
+ */
+void setFrameMode(FrameMode mode);
+
+/**
+ * Cycle on-demand → capped → uncapped
+ */
+void cycleFrameMode();
+
+/**
+ * Parse a mode name ("on-demand", "capped", "uncapped"), returns false if unknown
+ */
+bool parseFrameMode(const char* name, FrameMode& mode);
+
+/**
+ * Human-readable mode name
+ */
+const char* frameModeName(FrameMode mode);
+
+/**
+ * Whether something in the scene changes without input (physics, ...)
+ */
+bool sceneAnimating();
+
+#endif // SCHEDULER_H
@@ -0,0 +1,482 @@
+#include "snapshot.h"
+#include "matrix.h"
+#include "model.h"
+#include "../include/trace.h"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <cfloat>
+#include <map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// ============================================================================
+// FILE FORMAT
+// ============================================================================
+
+static const char SNAPSHOT_MAGIC[8] = {'S', 'C', 'E', 'N', 'E', 'S', 'N', 'P'};
+static const uint32_t SNAPSHOT_VERSION = 1;
+static const uint64_t SNAPSHOT_ALIGN = 16;
+
+// Offsets in the file become pointers once mapped
+template <typename T>
+union SnapshotRef {
+    uint64_t offset;
+    const T* ptr;
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t fileSize;
+    uint32_t nodeCount, modelCount, meshCount, bodyCount;
+    uint64_t nodes, models, meshes, bodies;  // section offsets
+    int32_t hasWindow, windowWidth, windowHeight, hasCamera;
+    Camera camera;
+    PhysicsSettings physics;
+};
+
+// Groups in pre-order: each node is followed by its children's subtrees
+struct SnapshotNode {
+    float local[16];      // the group's transforms as one matrix (bodies: without translations)
+    float world[16];      // static world matrix (bodies: at their initial position)
+    float boundsMin[3];   // world-space box around every vertex in the subtree
+    float boundsMax[3];
+    int32_t parent;
+    uint32_t childCount;
+    uint32_t firstModel, modelCount;
+    int32_t body;
+    uint32_t reserved;
+};
+
+struct SnapshotModel {
+    SnapshotRef<char> file;
+    uint32_t mesh;
+    float r, g, b;
+    uint32_t cull;
+    uint32_t reserved;
+};
+
+struct SnapshotMesh {
+    SnapshotRef<char> file;
+    SnapshotRef<Vertex> vertices;
+    uint64_t vertexCount;
+    float boundsMin[3];   // object space
+    float boundsMax[3];
+};
+
+static uint64_t alignUp(uint64_t n) {
+    return (n + SNAPSHOT_ALIGN - 1) & ~(SNAPSHOT_ALIGN - 1);
+}
+
+bool isSnapshotFile(const char* filename) {
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    ifstream file(filename, ios::binary);
+    return file.read(magic, sizeof(magic)) && memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+}
+
+// ============================================================================
+// WRITING
+// ============================================================================
+
+struct SnapshotWriter {
+    const Scene& scene;
+    vector<SnapshotNode> nodes;
+    vector<SnapshotModel> models;
+    vector<SnapshotMesh> meshes;
+    vector<const Mesh*> meshData;
+    map<const Mesh*, uint32_t> meshIndex;
+    string strings;
+    map<string, uint64_t> stringIndex;  // offsets within strings
+
+    SnapshotWriter(const Scene& s) : scene(s) {}
+
+    uint64_t addString(const string& s) {
+        auto it = stringIndex.find(s);
+        if (it != stringIndex.end()) return it->second;
+        uint64_t offset = strings.size();
+        strings.append(s.c_str(), s.size() + 1);
+        stringIndex[s] = offset;
+        return offset;
+    }
+
+    uint32_t addMesh(const Mesh* mesh) {
+        auto it = meshIndex.find(mesh);
+        if (it != meshIndex.end()) return it->second;
+
+        SnapshotMesh record;
+        record.file.offset = addString(mesh->file);
+        record.vertices.offset = 0;  // set once the layout is known
+        record.vertexCount = mesh->vertexCount;
+        for (int i = 0; i < 3; i++) {
+            record.boundsMin[i] = mesh->vertexCount ? FLT_MAX : 0.0f;
+            record.boundsMax[i] = mesh->vertexCount ? -FLT_MAX : 0.0f;
+        }
+        for (size_t i = 0; i < mesh->vertexCount; i++) {
+            const float* v = &mesh->vertices[i].x;
+            for (int k = 0; k < 3; k++) {
+                if (v[k] < record.boundsMin[k]) record.boundsMin[k] = v[k];
+                if (v[k] > record.boundsMax[k]) record.boundsMax[k] = v[k];
+            }
+        }
+
+        uint32_t index = meshes.size();
+        meshes.push_back(record);
+        meshData.push_back(mesh);
+        meshIndex[mesh] = index;
+        return index;
+    }
+
+    static void growBounds(SnapshotNode& node, const Vertex& p) {
+        const float* v = &p.x;
+        for (int k = 0; k < 3; k++) {
+            if (v[k] < node.boundsMin[k]) node.boundsMin[k] = v[k];
+            if (v[k] > node.boundsMax[k]) node.boundsMax[k] = v[k];
+        }
+    }
+
+    /**
+     * Append a group (and, after its children, the prototype it instances)
+     */
+    uint32_t addNode(const Group& g, const Mat4& parentWorld, int32_t parent) {
+        const PhysicsWorld& physics = scene.physics;
+        bool simulated = g.body >= 0 && physics.settings.enabled;
+
+        Mat4 local;
+        if (g.hasMatrix) local = g.matrix;
+        for (const auto& t : g.transforms) {
+            if (t.type == TRANSLATE && simulated) continue;
+            mat4Apply(local, t);
+        }
+        Mat4 world;
+        if (simulated) {
+            const Body& b = physics.bodies[g.body];
+            Transform at = {TRANSLATE, b.x, b.y, b.z, 0.0f};
+            world = mat4Multiply(mat4FromTransform(at), mat4Multiply(mat4Linear(parentWorld), local));
+        } else {
+            world = mat4Multiply(parentWorld, local);
+        }
+
+        uint32_t index = nodes.size();
+        nodes.emplace_back();
+        {
+            SnapshotNode& node = nodes.back();
+            memcpy(node.local, local.m, sizeof(node.local));
+            memcpy(node.world, world.m, sizeof(node.world));
+            for (int k = 0; k < 3; k++) {
+                node.boundsMin[k] = FLT_MAX;
+                node.boundsMax[k] = -FLT_MAX;
+            }
+            node.parent = parent;
+            node.childCount = g.children.size() + (g.instance ? 1 : 0);
+            node.firstModel = models.size();
+            node.modelCount = g.models.size();
+            node.body = simulated ? g.body : -1;
+            node.reserved = 0;
+        }
+
+        for (const auto& m : g.models) {
+            SnapshotModel record;
+            record.file.offset = addString(m.file);
+            record.mesh = addMesh(m.mesh.get());
+            record.r = m.r;
+            record.g = m.g;
+            record.b = m.b;
+            record.cull = m.cull ? 1 : 0;
+            record.reserved = 0;
+            models.push_back(record);
+
+            // Box of the mesh's box corners in world space
+            const SnapshotMesh& mesh = meshes[record.mesh];
+            if (mesh.vertexCount == 0) continue;
+            for (int c = 0; c < 8; c++) {
+                Vertex corner = {(c & 1) ? mesh.boundsMax[0] : mesh.boundsMin[0],
+                                 (c & 2) ? mesh.boundsMax[1] : mesh.boundsMin[1],
+                                 (c & 4) ? mesh.boundsMax[2] : mesh.boundsMin[2]};
+                growBounds(nodes[index], mat4TransformPoint(world, corner));
+            }
+        }
+
+        vector<uint32_t> children;
+        for (const auto& child : g.children) {
+            children.push_back(addNode(child, world, index));
+        }
+        if (g.instance) {
+            children.push_back(addNode(*g.instance, world, index));
+        }
+        for (uint32_t child : children) {
+            const SnapshotNode& c = nodes[child];
+            if (c.boundsMin[0] > c.boundsMax[0]) continue;  // empty subtree
+            Vertex lo = {c.boundsMin[0], c.boundsMin[1], c.boundsMin[2]};
+            Vertex hi = {c.boundsMax[0], c.boundsMax[1], c.boundsMax[2]};
+            growBounds(nodes[index], lo);
+            growBounds(nodes[index], hi);
+        }
+        return index;
+    }
+};
+
+static void writePadding(ofstream& out, uint64_t& at, uint64_t to) {
+    static const char zeros[SNAPSHOT_ALIGN] = {0};
+    out.write(zeros, to - at);
+    at = to;
+}
+
+bool writeSnapshot(const Scene& scene, const char* filename) {
+    TraceScope trace("writeSnapshot", "snapshot", filename);
+    SnapshotWriter w(scene);
+    w.addNode(scene.root, Mat4(), -1);
+
+    // Layout: header, nodes, models, meshes, bodies, strings, vertex data
+    SnapshotHeader header;
+    memset((void*)&header, 0, sizeof(header));  // no stray padding bytes in the file
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.nodeCount = w.nodes.size();
+    header.modelCount = w.models.size();
+    header.meshCount = w.meshes.size();
+    header.bodyCount = scene.physics.bodies.size();
+    header.hasWindow = scene.hasWindow;
+    header.windowWidth = scene.windowWidth;
+    header.windowHeight = scene.windowHeight;
+    header.hasCamera = scene.hasCamera;
+    header.camera = scene.camera;
+    header.physics = scene.physics.settings;
+
+    uint64_t at = alignUp(sizeof(SnapshotHeader));
+    header.nodes = at;
+    at = alignUp(at + w.nodes.size() * sizeof(SnapshotNode));
+    header.models = at;
+    at = alignUp(at + w.models.size() * sizeof(SnapshotModel));
+    header.meshes = at;
+    at = alignUp(at + w.meshes.size() * sizeof(SnapshotMesh));
+    header.bodies = at;
+    at = alignUp(at + scene.physics.bodies.size() * sizeof(Body));
+    uint64_t stringsAt = at;
+    at = alignUp(at + w.strings.size());
+    for (auto& mesh : w.meshes) {
+        mesh.vertices.offset = at;
+        at = alignUp(at + mesh.vertexCount * sizeof(Vertex));
+    }
+    for (auto& mesh : w.meshes) mesh.file.offset += stringsAt;
+    for (auto& model : w.models) model.file.offset += stringsAt;
+    header.fileSize = at;
+
+    ofstream out(filename, ios::binary | ios::trunc);
+    if (!out.is_open()) {
+        cerr << "Error: Could not write snapshot " << filename << endl;
+        return false;
+    }
+    uint64_t written = 0;
+    out.write((const char*)&header, sizeof(header));
+    written += sizeof(header);
+    writePadding(out, written, header.nodes);
+    out.write((const char*)w.nodes.data(), w.nodes.size() * sizeof(SnapshotNode));
+    written += w.nodes.size() * sizeof(SnapshotNode);
+    writePadding(out, written, header.models);
+    out.write((const char*)w.models.data(), w.models.size() * sizeof(SnapshotModel));
+    written += w.models.size() * sizeof(SnapshotModel);
+    writePadding(out, written, header.meshes);
+    out.write((const char*)w.meshes.data(), w.meshes.size() * sizeof(SnapshotMesh));
+    written += w.meshes.size() * sizeof(SnapshotMesh);
+    writePadding(out, written, header.bodies);
+    out.write((const char*)scene.physics.bodies.data(), scene.physics.bodies.size() * sizeof(Body));
+    written += scene.physics.bodies.size() * sizeof(Body);
+    writePadding(out, written, stringsAt);
+    out.write(w.strings.data(), w.strings.size());
+    written += w.strings.size();
+    for (size_t i = 0; i < w.meshes.size(); i++) {
+        writePadding(out, written, w.meshes[i].vertices.offset);
+        size_t bytes = w.meshes[i].vertexCount * sizeof(Vertex);
+        out.write((const char*)w.meshData[i]->vertices, bytes);
+        written += bytes;
+    }
+    writePadding(out, written, header.fileSize);
+    out.close();
+    if (!out) {
+        cerr << "Error: Failed writing snapshot " << filename << endl;
+        return false;
+    }
+
+    cout << "Snapshot written: " << header.nodeCount << " nodes, " << header.modelCount
+         << " models, " << header.meshCount << " meshes, "
+         << header.fileSize / (1024.0 * 1024.0) << " MB" << endl;
+    return true;
+}
+
+// ============================================================================
+// LOADING
+// ============================================================================
+
+/**
+ * Map a file copy-on-write (the fix-up writes pointers into the tables)
+ */
+static shared_ptr<char> mapFile(const char* filename, uint64_t& size) {
+#ifndef _WIN32
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    size = st.st_size;
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return nullptr;
+    uint64_t length = size;
+    return shared_ptr<char>((char*)base, [length](char* p) { munmap(p, length); });
+#else
+    ifstream file(filename, ios::binary | ios::ate);
+    if (!file.is_open()) return nullptr;
+    size = file.tellg();
+    shared_ptr<char> data(new char[size], default_delete<char[]>());
+    file.seekg(0);
+    if (!file.read(data.get(), size)) return nullptr;
+    return data;
+#endif
+}
+
+static bool inFile(uint64_t offset, uint64_t bytes, uint64_t size) {
+    return offset <= size && bytes <= size - offset;
+}
+
+static bool arrayInFile(uint64_t offset, uint64_t count, uint64_t stride, uint64_t size) {
+    return offset <= size && count <= (size - offset) / stride;
+}
+
+// Strings are stored NUL-terminated; the terminator must lie inside the mapping
+static bool stringInFile(const char* base, uint64_t offset, uint64_t size) {
+    return offset < size && memchr(base + offset, '\0', size - offset) != nullptr;
+}
+
+/**
+ * Rebuild a group from its node; returns false if the tree is malformed
+ */
+static bool buildGroup(Group& g, uint32_t& index, const SnapshotHeader& header,
+                       const SnapshotNode* nodes, const SnapshotModel* models,
+                       const vector<MeshPtr>& meshes) {
+    if (index >= header.nodeCount) return false;
+    const SnapshotNode& node = nodes[index++];
+    if (node.firstModel > header.modelCount || node.modelCount > header.modelCount - node.firstModel) {
+        return false;
+    }
+    if (node.body >= (int32_t)header.bodyCount) return false;
+
+    g.hasMatrix = true;
+    memcpy(g.matrix.m, node.local, sizeof(node.local));
+    g.body = node.body;
+    for (uint32_t i = 0; i < node.modelCount; i++) {
+        const SnapshotModel& record = models[node.firstModel + i];
+        g.models.emplace_back();
+        Model& m = g.models.back();
+        m.file = record.file.ptr;
+        m.mesh = meshes[record.mesh];
+        m.r = record.r;
+        m.g = record.g;
+        m.b = record.b;
+        m.cull = record.cull != 0;
+    }
+    for (uint32_t i = 0; i < node.childCount; i++) {
+        g.children.emplace_back();
+        if (!buildGroup(g.children.back(), index, header, nodes, models, meshes)) return false;
+    }
+    return true;
+}
+
+bool loadSnapshot(const char* filename, Scene& scene) {
+    TraceScope trace("loadSnapshot", "snapshot", filename);
+    auto start = chrono::steady_clock::now();
+    uint64_t size = 0;
+    shared_ptr<char> mapping = mapFile(filename, size);
+    if (!mapping) {
+        cerr << "Error: Could not map snapshot " << filename << endl;
+        return false;
+    }
+    char* base = mapping.get();
+
+    SnapshotHeader& header = *(SnapshotHeader*)base;
+    if (size < sizeof(SnapshotHeader) || memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        header.version != SNAPSHOT_VERSION || header.headerSize != sizeof(SnapshotHeader) ||
+        header.fileSize != size) {
+        cerr << "Error: " << filename << " is not a snapshot for this engine version (re-run scenec)" << endl;
+        return false;
+    }
+    if (!inFile(header.nodes, (uint64_t)header.nodeCount * sizeof(SnapshotNode), size) ||
+        !inFile(header.models, (uint64_t)header.modelCount * sizeof(SnapshotModel), size) ||
+        !inFile(header.meshes, (uint64_t)header.meshCount * sizeof(SnapshotMesh), size) ||
+        !inFile(header.bodies, (uint64_t)header.bodyCount * sizeof(Body), size) ||
+        header.nodeCount == 0) {
+        cerr << "Error: Snapshot " << filename << " is truncated" << endl;
+        return false;
+    }
+    SnapshotNode* nodes = (SnapshotNode*)(base + header.nodes);
+    SnapshotModel* models = (SnapshotModel*)(base + header.models);
+    SnapshotMesh* meshRecords = (SnapshotMesh*)(base + header.meshes);
+    const Body* bodies = (const Body*)(base + header.bodies);
+
+    // Pointer fix-up: offsets in the mesh and model tables become addresses
+    vector<MeshPtr> meshes;
+    meshes.reserve(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+        SnapshotMesh& record = meshRecords[i];
+        if (!stringInFile(base, record.file.offset, size) ||
+            !arrayInFile(record.vertices.offset, record.vertexCount, sizeof(Vertex), size)) {
+            cerr << "Error: Snapshot " << filename << " has a corrupt mesh table" << endl;
+            return false;
+        }
+        record.file.ptr = base + record.file.offset;
+        record.vertices.ptr = (const Vertex*)(base + record.vertices.offset);
+
+        shared_ptr<Mesh> mesh = make_shared<Mesh>();
+        mesh->file = record.file.ptr;
+        mesh->vertices = record.vertices.ptr;
+        mesh->vertexCount = record.vertexCount;
+        mesh->owner = mapping;
+        meshes.push_back(mesh);
+    }
+    for (uint32_t i = 0; i < header.modelCount; i++) {
+        SnapshotModel& record = models[i];
+        if (!stringInFile(base, record.file.offset, size) || record.mesh >= header.meshCount) {
+            cerr << "Error: Snapshot " << filename << " has a corrupt model table" << endl;
+            return false;
+        }
+        record.file.ptr = base + record.file.offset;
+    }
+
+    uint32_t index = 0;
+    if (!buildGroup(scene.root, index, header, nodes, models, meshes)) {
+        cerr << "Error: Snapshot " << filename << " has a corrupt node table" << endl;
+        scene.root.children.clear();
+        scene.root.models.clear();
+        return false;
+    }
+
+    scene.file = filename;
+    scene.hasWindow = header.hasWindow != 0;
+    scene.windowWidth = header.windowWidth;
+    scene.windowHeight = header.windowHeight;
+    scene.hasCamera = header.hasCamera != 0;
+    scene.camera = header.camera;
+    scene.physics.settings = header.physics;
+    scene.physics.bodies.assign(bodies, bodies + header.bodyCount);
+    scene.physics.forcesValid = false;
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Snapshot loaded successfully! (" << header.nodeCount << " nodes, "
+         << header.meshCount << " meshes, " << size / (1024.0 * 1024.0) << " MB mapped in "
+         << ms << " ms)" << endl;
+    return true;
+}
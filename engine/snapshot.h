@@ -0,0 +1,35 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "scene.h"
+
+using namespace std;
+
+// ============================================================================
+// SCENE SNAPSHOTS
+// ============================================================================
+
+// A snapshot is a scene compiled by scenec into one binary file: flattened
+// nodes with precomputed matrices and bounds, plus the vertex data of every
+// referenced figure. Loading is a single mmap and an offset-to-pointer
+// fix-up; meshes render straight from the mapping. The layout follows the
+// engine's structs, so snapshots must be rebuilt when the engine changes
+// (a version mismatch is rejected on load).
+
+/**
+ * Whether a file starts with the snapshot magic
+ */
+bool isSnapshotFile(const char* filename);
+
+/**
+ * Write a loaded scene and all the meshes it references to a snapshot
+ * (instances are expanded into plain nodes)
+ */
+bool writeSnapshot(const Scene& scene, const char* filename);
+
+/**
+ * Map a snapshot into a new scene (no global state touched)
+ */
+bool loadSnapshot(const char* filename, Scene& scene);
+
+#endif // SNAPSHOT_H
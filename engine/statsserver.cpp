@@ -0,0 +1,554 @@
+#include "statsserver.h"
+#include "config.h"
+#include "model.h"
+#include "memory.h"
+#include "optimize.h"
+#include "profiler.h"
+#include "reload.h"
+#include "rendering.h"
+#include "scheduler.h"
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#define HAVE_UNIX_SOCKETS
+#endif
+
+using namespace std;
+
+// How often the GLUT thread publishes a snapshot and runs queued commands
+static const unsigned int STATS_PUBLISH_MS = 250;
+// How long a command waits for the GLUT thread before giving up
+static const int STATS_COMMAND_TIMEOUT_MS = 5000;
+// Longest request read from a client (an HTTP request line and headers)
+static const size_t STATS_MAX_REQUEST = 8192;
+// Clients served at once, each on its own thread; more are turned away unread
+static const int STATS_MAX_CLIENTS = 16;
+// Clients waiting on a command at once; more get a busy reply
+static const int STATS_MAX_COMMAND_CLIENTS = 4;
+
+struct StatsSnapshot {
+    string config;
+    const char* frameMode;
+    double uptimeSeconds;
+    long long frames;             // frames drawn since start
+    double fps;                   // over the last second (0 when idle)
+    FrameTimeStats frameMs;       // over the profiler's history
+    double phaseMeanMs[PHASE_COUNT];
+    int models;                   // last frame
+    long long triangles;          // last frame
+    int stateChanges;             // last frame
+    double residentMB;
+    double peakMB;
+    int meshes;                   // figures in the model cache
+    long long meshVertices;
+    double meshMB;                // vertex payload of the cached figures
+    int groups;
+    int sceneGeneration;
+    bool reloading;
+    StatsSnapshot() : frameMode(""), uptimeSeconds(0.0), frames(0), fps(0.0),
+        frameMs(), models(0), triangles(0), stateChanges(0), residentMB(0.0), peakMB(0.0),
+        meshes(0), meshVertices(0), meshMB(0.0), groups(0), sceneGeneration(0), reloading(false) {
+        for (int p = 0; p < PHASE_COUNT; p++) phaseMeanMs[p] = 0.0;
+    }
+};
+
+// A request that has to run on the GLUT thread; owned by the waiting client
+struct StatsCommand {
+    string name;
+    string reply;
+    bool done;
+};
+
+static mutex statsLock;
+static condition_variable commandFinished;
+static StatsSnapshot published;
+static deque<StatsCommand*> queuedCommands;
+static int clientThreads = 0;    // client threads running
+static int commandClients = 0;   // client threads waiting on a command
+static bool headlessServer = false;  // benchmark: no GLUT loop, snapshots from pollStatsServer
+
+// ============================================================================
+// SNAPSHOT (GLUT thread)
+// ============================================================================
+
+static chrono::steady_clock::time_point serverStart;
+static chrono::steady_clock::time_point fpsWindowStart;
+static long long fpsWindowFrames = 0;
+static double windowFPS = 0.0;
+static int countedGeneration = -1;
+static int countedGroups = 0;
+
+static double secondsSince(chrono::steady_clock::time_point t) {
+    return chrono::duration<double>(chrono::steady_clock::now() - t).count();
+}
+
+static StatsSnapshot takeSnapshot() {
+    StatsSnapshot s;
+    s.config = currentConfigFile;
+    s.frameMode = frameModeName(frameMode);
+    s.uptimeSeconds = secondsSince(serverStart);
+    s.frames = framesDrawn;
+
+    // Frames counted over whole seconds, so on-demand idling reads as 0
+    double window = secondsSince(fpsWindowStart);
+    if (window >= 1.0) {
+        windowFPS = (framesDrawn - fpsWindowFrames) / window;
+        fpsWindowFrames = framesDrawn;
+        fpsWindowStart = chrono::steady_clock::now();
+    }
+    s.fps = windowFPS;
+
+    s.frameMs = frameTimeStats(PHASE_COUNT);
+    for (int p = 0; p < PHASE_COUNT; p++) s.phaseMeanMs[p] = frameTimeStats(p).avg;
+    if (frameHistorySize() > 0) {
+        const FrameSample& last = frameHistory(0);
+        s.models = last.models;
+        s.triangles = last.triangles;
+        s.stateChanges = last.stateChanges;
+    }
+
+    s.residentMB = currentMemoryMB();
+    s.peakMB = max(s.residentMB, peakMemoryMB());
+    for (const auto& info : modelCacheContents()) {
+        s.meshes++;
+        s.meshVertices += info.mesh->vertexCount;
+    }
+    s.meshMB = s.meshVertices * sizeof(Vertex) / (1024.0 * 1024.0);
+
+    // Counting walks the whole graph, so only after the scene changed
+    if (countedGeneration != sceneGeneration) {
+        countedGroups = measureSceneGraph(*activeScene, false).groups;
+        countedGeneration = sceneGeneration;
+    }
+    s.groups = countedGroups;
+    s.sceneGeneration = sceneGeneration;
+    s.reloading = reloadInProgress();
+    return s;
+}
+
+static string runCommand(const string& name) {
+    if (name == "reload") {
+        if (headlessServer) return "error: reload is not available in benchmark mode\n";
+        if (reloadInProgress()) return "busy: a reload is already running\n";
+        reloadConfig();
+        return "reloading " + currentConfigFile + "\n";
+    }
+    if (name == "memory") {
+        ostringstream report;
+        printMemoryReport(*activeScene, report);
+        return report.str();
+    }
+    return "error: unknown command " + name + "\n";
+}
+
+static chrono::steady_clock::time_point lastPublish;
+
+static void publishNow() {
+    lastPublish = chrono::steady_clock::now();
+    StatsSnapshot snapshot = takeSnapshot();
+    StatsCommand* command = NULL;
+    {
+        lock_guard<mutex> guard(statsLock);
+        published = snapshot;
+        if (!queuedCommands.empty()) {
+            command = queuedCommands.front();
+            queuedCommands.pop_front();
+        }
+    }
+    // One command per tick keeps a burst of requests from stalling a frame
+    if (command) {
+        string reply = runCommand(command->name);
+        lock_guard<mutex> guard(statsLock);
+        command->reply = reply;
+        command->done = true;
+        commandFinished.notify_all();
+    }
+}
+
+static void publishStats(int) {
+    publishNow();
+    glutTimerFunc(STATS_PUBLISH_MS, publishStats, 0);
+}
+
+void pollStatsServer() {
+    if (!headlessServer) return;
+    if (secondsSince(lastPublish) * 1000.0 >= STATS_PUBLISH_MS) publishNow();
+}
+
+// ============================================================================
+// REPLIES (client threads)
+// ============================================================================
+
+static string jsonString(const string& s) {
+    string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c < 0x20) { out += ' '; continue; }
+        out += c;
+    }
+    return out + "\"";
+}
+
+static string statsJSON(const StatsSnapshot& s) {
+    ostringstream out;
+    out << "{\n"
+        << "  \"config\": " << jsonString(s.config) << ",\n"
+        << "  \"frame_mode\": " << jsonString(s.frameMode) << ",\n"
+        << "  \"uptime_s\": " << s.uptimeSeconds << ",\n"
+        << "  \"frames\": " << s.frames << ",\n"
+        << "  \"fps\": " << s.fps << ",\n"
+        << "  \"frame_ms\": {\n"
+        << "    \"window\": " << s.frameMs.frames << ",\n"
+        << "    \"min\": " << s.frameMs.min << ",\n"
+        << "    \"mean\": " << s.frameMs.avg << ",\n"
+        << "    \"p50\": " << s.frameMs.p50 << ",\n"
+        << "    \"p95\": " << s.frameMs.p95 << ",\n"
+        << "    \"p99\": " << s.frameMs.p99 << ",\n"
+        << "    \"max\": " << s.frameMs.max << "\n"
+        << "  },\n"
+        << "  \"phase_mean_ms\": {\n";
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        out << "    \"" << framePhaseName(p) << "\": " << s.phaseMeanMs[p]
+            << (p + 1 < PHASE_COUNT ? ",\n" : "\n");
+    }
+    out << "  },\n"
+        << "  \"models_per_frame\": " << s.models << ",\n"
+        << "  \"triangles_per_frame\": " << s.triangles << ",\n"
+        << "  \"state_changes_per_frame\": " << s.stateChanges << ",\n"
+        << "  \"resident_mb\": " << s.residentMB << ",\n"
+        << "  \"peak_rss_mb\": " << s.peakMB << ",\n"
+        << "  \"meshes\": " << s.meshes << ",\n"
+        << "  \"mesh_vertices\": " << s.meshVertices << ",\n"
+        << "  \"mesh_mb\": " << s.meshMB << ",\n"
+        << "  \"groups\": " << s.groups << ",\n"
+        << "  \"scene_generation\": " << s.sceneGeneration << ",\n"
+        << "  \"reload_in_progress\": " << (s.reloading ? "true" : "false") << "\n"
+        << "}\n";
+    return out.str();
+}
+
+static void metric(ostream& out, const char* name, const char* type, const char* help, double value) {
+    out << "# HELP engine_" << name << " " << help << "\n"
+        << "# TYPE engine_" << name << " " << type << "\n"
+        << "engine_" << name << " " << value << "\n";
+}
+
+static string statsPrometheus(const StatsSnapshot& s) {
+    ostringstream out;
+    out << "# HELP engine_info Loaded config and frame mode\n"
+        << "# TYPE engine_info gauge\n"
+        << "engine_info{config=" << jsonString(s.config) << ",frame_mode=" << jsonString(s.frameMode) << "} 1\n";
+    metric(out, "uptime_seconds", "counter", "Seconds since the stats endpoint started", s.uptimeSeconds);
+    metric(out, "frames_total", "counter", "Frames drawn", (double)s.frames);
+    metric(out, "fps", "gauge", "Frames drawn per second over the last second", s.fps);
+
+    out << "# HELP engine_frame_time_ms Frame time over the recent frame history\n"
+        << "# TYPE engine_frame_time_ms summary\n"
+        << "engine_frame_time_ms{quantile=\"0\"} " << s.frameMs.min << "\n"
+        << "engine_frame_time_ms{quantile=\"0.5\"} " << s.frameMs.p50 << "\n"
+        << "engine_frame_time_ms{quantile=\"0.95\"} " << s.frameMs.p95 << "\n"
+        << "engine_frame_time_ms{quantile=\"0.99\"} " << s.frameMs.p99 << "\n"
+        << "engine_frame_time_ms{quantile=\"1\"} " << s.frameMs.max << "\n"
+        << "engine_frame_time_ms_sum " << s.frameMs.avg * s.frameMs.frames << "\n"
+        << "engine_frame_time_ms_count " << s.frameMs.frames << "\n";
+
+    out << "# HELP engine_phase_time_ms Mean time per frame phase over the recent frame history\n"
+        << "# TYPE engine_phase_time_ms gauge\n";
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        out << "engine_phase_time_ms{phase=\"" << framePhaseName(p) << "\"} " << s.phaseMeanMs[p] << "\n";
+    }
+
+    metric(out, "models_per_frame", "gauge", "Models drawn in the last frame", s.models);
+    metric(out, "triangles_per_frame", "gauge", "Triangles submitted in the last frame", (double)s.triangles);
+    metric(out, "state_changes_per_frame", "gauge", "Color and culling calls in the last frame", s.stateChanges);
+    metric(out, "resident_memory_mb", "gauge", "Resident set size in MB", s.residentMB);
+    metric(out, "peak_memory_mb", "gauge", "Peak resident set size in MB", s.peakMB);
+    metric(out, "meshes", "gauge", "Figures in the model cache", s.meshes);
+    metric(out, "mesh_vertices", "gauge", "Vertices of the cached figures", (double)s.meshVertices);
+    metric(out, "mesh_mb", "gauge", "Vertex data of the cached figures in MB", s.meshMB);
+    metric(out, "groups", "gauge", "Groups in the active scene graph", s.groups);
+    metric(out, "scene_generation", "counter", "Reloads applied to the live scene", s.sceneGeneration);
+    metric(out, "reload_in_progress", "gauge", "1 while a reload is loading or waiting to be applied", s.reloading ? 1 : 0);
+    return out.str();
+}
+
+/**
+ * Hand a command to the GLUT thread and wait for its reply
+ */
+static string queueCommand(const string& name) {
+    StatsCommand command;
+    command.name = name;
+    command.done = false;
+    unique_lock<mutex> lock(statsLock);
+    queuedCommands.push_back(&command);
+    bool finished = commandFinished.wait_for(lock, chrono::milliseconds(STATS_COMMAND_TIMEOUT_MS),
+                                             [&]() { return command.done; });
+    if (!finished) {
+        auto it = find(queuedCommands.begin(), queuedCommands.end(), &command);
+        if (it != queuedCommands.end()) {
+            // Never picked up (no GLUT loop running yet): withdraw it
+            queuedCommands.erase(it);
+            return "error: the engine did not answer\n";
+        }
+        // Already running on the GLUT thread
+        commandFinished.wait(lock, [&]() { return command.done; });
+    }
+    return command.reply;
+}
+
+#ifdef HAVE_UNIX_SOCKETS
+
+static void sendAll(int fd, const string& data) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;  // a client that went away must not kill the engine
+#else
+    const int flags = 0;
+#endif
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(fd, data.data() + sent, data.size() - sent, flags);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        sent += n;
+    }
+}
+
+static bool isHTTP(const string& request) {
+    return request.compare(0, 4, "GET ") == 0 || request.compare(0, 5, "POST ") == 0 ||
+           request.compare(0, 5, "HEAD ") == 0;
+}
+
+/**
+ * Read the first line, or for HTTP everything up to the blank line after
+ * the headers (so the client is not cut off while still sending)
+ */
+static string readRequest(int fd) {
+    string request;
+    char buffer[512];
+    while (request.size() < STATS_MAX_REQUEST) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        request.append(buffer, n);
+        size_t newline = request.find('\n');
+        if (newline == string::npos) continue;
+        if (!isHTTP(request) || request.find("\r\n\r\n") != string::npos ||
+            request.find("\n\n") != string::npos) break;
+    }
+    return request;
+}
+
+static string httpReply(const char* status, const char* contentType, const string& body) {
+    ostringstream out;
+    out << "HTTP/1.1 " << status << "\r\n"
+        << "Content-Type: " << contentType << "\r\n"
+        << "Content-Length: " << body.size() << "\r\n"
+        << "Connection: close\r\n\r\n"
+        << body;
+    return out.str();
+}
+
+// One parsed request line
+struct StatsRequest {
+    bool http;
+    string method;  // HTTP only
+    string name;    // stats, metrics, reload, memory
+};
+
+static StatsRequest parseRequest(const string& request) {
+    string line = request.substr(0, request.find('\n'));
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+
+    StatsRequest r;
+    r.http = isHTTP(line);
+    if (r.http) {
+        istringstream parts(line);
+        string path;
+        parts >> r.method >> path;
+        size_t start = path.find_first_not_of('/');
+        r.name = start == string::npos ? "" : path.substr(start, path.find('?') - start);
+    } else {
+        r.name = line;
+    }
+    if (r.name.empty()) r.name = "stats";
+    return r;
+}
+
+static bool isCommand(const StatsRequest& r) {
+    return r.name == "reload" || r.name == "memory";
+}
+
+static void reply(int fd, const StatsRequest& r, const char* status, const char* contentType,
+                  const string& body) {
+    if (!r.http) {
+        sendAll(fd, body);
+    } else if (r.method == "HEAD") {
+        string full = httpReply(status, contentType, body);
+        sendAll(fd, full.substr(0, full.size() - body.size()));
+    } else {
+        sendAll(fd, httpReply(status, contentType, body));
+    }
+}
+
+static void answer(int fd, const StatsRequest& r) {
+    string body;
+    const char* contentType = "text/plain; charset=utf-8";
+    const char* status = "200 OK";
+    if (r.name == "stats" || r.name == "metrics") {
+        StatsSnapshot snapshot;
+        {
+            lock_guard<mutex> guard(statsLock);
+            snapshot = published;
+        }
+        if (r.name == "stats") {
+            body = statsJSON(snapshot);
+            contentType = "application/json";
+        } else {
+            body = statsPrometheus(snapshot);
+            contentType = "text/plain; version=0.0.4";
+        }
+    } else if (isCommand(r)) {
+        if (r.http && r.name == "reload" && r.method != "POST") {
+            status = "405 Method Not Allowed";
+            body = "reload needs POST\n";
+        } else {
+            body = queueCommand(r.name);
+        }
+    } else {
+        status = "404 Not Found";
+        body = "unknown request '" + r.name + "' (stats, metrics, reload, memory)\n";
+    }
+    reply(fd, r, status, contentType, body);
+}
+
+/**
+ * Serve one client on its own thread: a client that connects and stays
+ * silent holds only its thread until the read times out, and a command
+ * waits for the GLUT thread (up to STATS_COMMAND_TIMEOUT_MS, longer once it
+ * runs) without stats and metrics scrapes queueing behind it
+ */
+static void serveClient(int fd) {
+    StatsRequest request = parseRequest(readRequest(fd));
+    bool command = isCommand(request);
+    bool busy = false;
+    if (command) {
+        lock_guard<mutex> guard(statsLock);
+        busy = commandClients >= STATS_MAX_COMMAND_CLIENTS;
+        if (!busy) commandClients++;
+    }
+    if (busy) {
+        reply(fd, request, "503 Service Unavailable", "text/plain; charset=utf-8",
+              "busy: too many commands waiting\n");
+    } else {
+        answer(fd, request);
+    }
+    close(fd);
+    lock_guard<mutex> guard(statsLock);
+    if (command && !busy) commandClients--;
+    clientThreads--;
+}
+
+static void serveClients(int listenFd) {
+    while (true) {
+        int client = accept(listenFd, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            cerr << "Stats endpoint stopped: " << strerror(errno) << endl;
+            return;
+        }
+        // A client that connects and says nothing is dropped after the timeout
+        struct timeval timeout = { 2, 0 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        bool busy;
+        {
+            lock_guard<mutex> guard(statsLock);
+            busy = clientThreads >= STATS_MAX_CLIENTS;
+            if (!busy) clientThreads++;
+        }
+        if (!busy) {
+            thread(serveClient, client).detach();
+            continue;
+        }
+        // Not read yet, so the reply cannot match the protocol; a plain line is enough
+        sendAll(client, "busy: too many clients\n");
+        close(client);
+    }
+}
+
+static string socketPath;
+
+static void removeSocket() {
+    unlink(socketPath.c_str());
+}
+
+bool startStatsServer(const string& path, bool headless) {
+    struct sockaddr_un address;
+    if (path.size() >= sizeof(address.sun_path)) {
+        cerr << "Stats socket path is too long: " << path << endl;
+        return false;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        cerr << "Could not create the stats socket: " << strerror(errno) << endl;
+        return false;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    // Replace a socket left behind by an engine that did not exit cleanly (never a regular file)
+    struct stat info;
+    if (lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) unlink(path.c_str());
+
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 8) != 0) {
+        cerr << "Could not listen on " << path << ": " << strerror(errno) << endl;
+        close(fd);
+        return false;
+    }
+    socketPath = path;
+    atexit(removeSocket);
+
+    // Frame times need phase timing, which is otherwise only on with the overlay or CSV
+    profileAlways = true;
+    frameProfiling = true;
+    serverStart = fpsWindowStart = chrono::steady_clock::now();
+    fpsWindowFrames = framesDrawn;
+    headlessServer = headless;
+    publishNow();
+    if (!headless) glutTimerFunc(STATS_PUBLISH_MS, publishStats, 0);
+
+    thread(serveClients, fd).detach();
+    cout << "Stats endpoint listening on " << path << endl;
+    return true;
+}
+
+#else
+
+bool startStatsServer(const string& path, bool headless) {
+    cerr << "Stats endpoint needs Unix domain sockets; not available on this platform" << endl;
+    return false;
+}
+
+#endif
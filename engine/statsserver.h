@@ -0,0 +1,40 @@
+#ifndef STATSSERVER_H
+#define STATSSERVER_H
+
+#include <string>
+
+using namespace std;
+
+// ============================================================================
+// LIVE STATS ENDPOINT
+// ============================================================================
+
+// Serves the engine's counters on a Unix domain socket from a background
+// thread, for monitoring without the on-screen HUD. A client sends one
+// request line and gets one reply, then the connection is closed:
+//   stats    JSON snapshot (also the reply to an empty request)
+//   metrics  Prometheus text exposition format
+//   reload   start a background reload of the config (key R)
+//   memory   the memory report (key U)
+// HTTP requests (GET /stats, /metrics, /memory; POST /reload) get an HTTP
+// reply, so `curl --unix-socket` and HTTP scrapers work as well.
+//
+// The GLUT thread publishes a snapshot and runs queued commands on a timer;
+// the server thread only copies the last snapshot, so a slow client never
+// holds up a frame. Commands are answered on a short-lived thread per
+// client, so stats and metrics scrapes never wait behind them.
+
+/**
+ * Listen on a socket path (an existing socket file is replaced); returns
+ * false if the socket can't be created. Call after the window exists, or
+ * with headless (--bench: no GLUT loop) and call pollStatsServer per frame.
+ */
+bool startStatsServer(const string& path, bool headless = false);
+
+/**
+ * Headless server: publish a snapshot and run a queued command when the
+ * publish interval has passed (reload is refused without a GLUT loop)
+ */
+void pollStatsServer();
+
+#endif // STATSSERVER_H
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""Start the engine headless (--bench) with --stats-socket and check that
+the endpoint answers: `stats` is valid JSON, `metrics` is Prometheus text
+and `memory` is answered while stats keep being served, also while a
+client that connected without a request is still open.
+
+Usage: stats_socket_test.py <engine binary> <config>
+(run from a directory where ../../configs and ../../figures exist)
+"""
+import json
+import os
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+
+def request(path, line, timeout=10.0):
+    client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    client.settimeout(timeout)
+    client.connect(path)
+    client.sendall(line.encode() + b"\n")
+    reply = b""
+    while True:
+        chunk = client.recv(65536)
+        if not chunk:
+            break
+        reply += chunk
+    client.close()
+    return reply.decode()
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+    engine, config = sys.argv[1], sys.argv[2]
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "engine.sock")
+        proc = subprocess.Popen([engine, "--bench", "--bench-warmup", "0", "--bench-frames", "1000000",
+                                 "--stats-socket", path, config],
+                                stdout=subprocess.DEVNULL, stderr=subprocess.PIPE)
+        try:
+            deadline = time.time() + 30
+            while not os.path.exists(path):
+                if proc.poll() is not None:
+                    print("engine exited early:\n" + proc.stderr.read().decode(), file=sys.stderr)
+                    return 1
+                if time.time() > deadline:
+                    print("stats socket did not appear", file=sys.stderr)
+                    return 1
+                time.sleep(0.05)
+
+            stats = json.loads(request(path, "stats"))
+            for key in ("config", "frames", "fps", "frame_ms", "groups", "reload_in_progress"):
+                if key not in stats:
+                    print("stats JSON has no '%s': %s" % (key, stats), file=sys.stderr)
+                    return 1
+
+            metrics = request(path, "metrics")
+            if "engine_frames_total" not in metrics:
+                print("metrics has no engine_frames_total:\n" + metrics, file=sys.stderr)
+                return 1
+
+            # A command waits for the render loop; stats must not wait with it
+            memory = {}
+            worker = threading.Thread(target=lambda: memory.update(reply=request(path, "memory")))
+            worker.start()
+            start = time.time()
+            json.loads(request(path, "stats"))
+            if time.time() - start > 1.0:
+                print("stats took %.2f s while a command was waiting" % (time.time() - start), file=sys.stderr)
+                return 1
+            worker.join(15)
+            if not memory.get("reply") or memory["reply"].startswith("error"):
+                print("memory command failed: %r" % memory.get("reply"), file=sys.stderr)
+                return 1
+
+            # A client that connects and says nothing must not hold up the others
+            silent = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            silent.connect(path)
+            start = time.time()
+            json.loads(request(path, "stats"))
+            silent.close()
+            if time.time() - start > 1.0:
+                print("stats took %.2f s behind a silent client" % (time.time() - start), file=sys.stderr)
+                return 1
+
+            http = request(path, "GET /stats HTTP/1.0\r\n")
+            head, _, body = http.partition("\r\n\r\n")
+            if not head.startswith("HTTP/1.1 200") or "application/json" not in head:
+                print("bad HTTP reply:\n" + head, file=sys.stderr)
+                return 1
+            json.loads(body)
+        finally:
+            proc.terminate()
+            proc.wait(10)
+    print("stats socket OK")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
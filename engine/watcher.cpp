@@ -0,0 +1,141 @@
+#include "watcher.h"
+#include "config.h"
+#include "model.h"
+#include "reload.h"
+#include <iostream>
+#include <string>
+#include <set>
+#include <map>
+#include <vector>
+
+#ifdef __APPLE__
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using namespace std;
+
+bool watchFiles = false;
+
+// Polling interval; also gives editors time to finish writing a file
+static const unsigned int WATCH_POLL_MS = 100;
+
+#ifdef __linux__
+
+int inotifyFd = -1;
+map<int, string> watchedDirs;     // watch descriptor -> directory (with trailing '/')
+int indexedGeneration = -1;       // scene generation the figure index was built from
+map<string, string> figureIndex;  // full path -> model file name as written in the config
+
+// Changes seen but not handed to the loader yet (it may still be busy)
+bool configDirty = false;
+set<string> dirtyModels;
+
+static string directoryOf(const string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == string::npos ? "./" : path.substr(0, slash + 1);
+}
+
+static void watchDirectory(const string& dir) {
+    for (const auto& entry : watchedDirs) {
+        if (entry.second == dir) return;
+    }
+    int wd = inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd < 0) {
+        cerr << "Warning: cannot watch " << dir << endl;
+        return;
+    }
+    watchedDirs[wd] = dir;
+}
+
+static void indexFigures(const Group& g) {
+    for (const auto& m : g.models) {
+        string path = modelFilePath(m.file);
+        if (figureIndex.count(path)) continue;
+        figureIndex[path] = m.file;
+        watchDirectory(directoryOf(path));
+    }
+    for (const auto& child : g.children) {
+        indexFigures(child);
+    }
+}
+
+/**
+ * Rebuild the set of referenced figures whenever a different scene is active
+ */
+static void refreshIndex() {
+    if (indexedGeneration == sceneGeneration) return;
+    figureIndex.clear();
+    indexFigures(activeScene->root);
+    for (const auto& prototype : activeScene->prototypes) {
+        indexFigures(prototype);
+    }
+    indexedGeneration = sceneGeneration;
+}
+
+static void readEvents() {
+    // Buffer aligned for inotify_event, large enough for a burst of saves
+    char buffer[16 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (true) {
+        ssize_t len = read(inotifyFd, buffer, sizeof(buffer));
+        if (len <= 0) break;  // EAGAIN: no more events
+        for (char* p = buffer; p < buffer + len; ) {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + ev->len;
+            if (ev->len == 0 || !watchedDirs.count(ev->wd)) continue;
+
+            string path = watchedDirs[ev->wd] + ev->name;
+            if (path == currentConfigFile) {
+                configDirty = true;
+            } else {
+                auto it = figureIndex.find(path);
+                if (it != figureIndex.end()) dirtyModels.insert(it->second);
+            }
+        }
+    }
+}
+
+static void pollWatcher(int) {
+    refreshIndex();
+    readEvents();
+
+    if (configDirty || !dirtyModels.empty()) {
+        vector<string> models(dirtyModels.begin(), dirtyModels.end());
+        if (reloadChanged(configDirty, models)) {
+            cout << "Change detected:" << (configDirty ? " config" : "");
+            for (const auto& m : models) cout << " " << m;
+            cout << endl;
+            configDirty = false;
+            dirtyModels.clear();
+        }
+    }
+    glutTimerFunc(WATCH_POLL_MS, pollWatcher, 0);
+}
+
+void startWatching() {
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        cerr << "Warning: inotify unavailable, file watching disabled" << endl;
+        return;
+    }
+    watchDirectory(directoryOf(currentConfigFile));
+    refreshIndex();
+    cout << "Watching " << currentConfigFile << " and " << figureIndex.size()
+         << " figure files for changes" << endl;
+    glutTimerFunc(WATCH_POLL_MS, pollWatcher, 0);
+}
+
+#else
+
+void startWatching() {
+    cerr << "Warning: file watching is only supported on Linux" << endl;
+}
+
+#endif
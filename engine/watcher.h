@@ -0,0 +1,16 @@
+#ifndef WATCHER_H
+#define WATCHER_H
+
+// ============================================================================
+// FILE WATCHING
+// ============================================================================
+
+extern bool watchFiles;
+
+/**
+ * Watch the current config and the figure files it references, and reload
+ * incrementally when they change (inotify on Linux; no-op elsewhere)
+ */
+void startWatching();
+
+#endif // WATCHER_H
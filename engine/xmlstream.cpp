@@ -0,0 +1,316 @@
+#include "xmlstream.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// Read size of the input buffer; memory use does not depend on the file size
+static const size_t STREAM_BUFFER_SIZE = 64 * 1024;
+
+struct XMLReader {
+    FILE* file;
+    char buffer[STREAM_BUFFER_SIZE];
+    size_t pos, len;
+    int line;
+    string error;
+
+    // Reused across elements so steady-state parsing does not allocate
+    string name;
+    vector<string> attrNames, attrValues;
+    vector<XMLStreamAttribute> attrs;
+    vector<string> open;  // names of the currently open elements
+
+    XMLReader(FILE* f) : file(f), pos(0), len(0), line(1) {}
+
+    bool fill() {
+        if (pos < len) return true;
+        len = fread(buffer, 1, sizeof(buffer), file);
+        pos = 0;
+        return len > 0;
+    }
+
+    // -1 at end of file
+    int peek() {
+        return fill() ? (unsigned char)buffer[pos] : -1;
+    }
+
+    int get() {
+        if (!fill()) return -1;
+        char c = buffer[pos++];
+        if (c == '\n') line++;
+        return (unsigned char)c;
+    }
+
+    bool fail(const string& message) {
+        if (error.empty()) error = message + " (line " + to_string(line) + ")";
+        return false;
+    }
+};
+
+// ============================================================================
+// LEXING HELPERS
+// ============================================================================
+
+static bool isSpace(int c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool isNameChar(int c) {
+    return c > 0 && !isSpace(c) && c != '>' && c != '/' && c != '=' && c != '<' &&
+           c != '"' && c != '\'' && c != '?' && c != '!';
+}
+
+static void skipSpace(XMLReader& r) {
+    while (isSpace(r.peek())) r.get();
+}
+
+static bool readName(XMLReader& r, string& out) {
+    out.clear();
+    while (isNameChar(r.peek())) out += (char)r.get();
+    return !out.empty() || r.fail("Expected a name");
+}
+
+/**
+ * Skip up to and including the terminator (for comments, PIs, CDATA). On a
+ * mismatch the match falls back to the longest prefix of the terminator
+ * that ends the text read so far (KMP), so "]]]>" still ends a CDATA section.
+ */
+static bool skipPast(XMLReader& r, const char* terminator) {
+    size_t n = strlen(terminator);
+    vector<size_t> fallback(n, 0);
+    for (size_t i = 1, k = 0; i < n; i++) {
+        while (k > 0 && terminator[i] != terminator[k]) k = fallback[k - 1];
+        if (terminator[i] == terminator[k]) k++;
+        fallback[i] = k;
+    }
+    size_t matched = 0;
+    while (matched < n) {
+        int c = r.get();
+        if (c < 0) return r.fail(string("Unterminated markup, expected '") + terminator + "'");
+        while (matched > 0 && c != (unsigned char)terminator[matched]) matched = fallback[matched - 1];
+        if (c == (unsigned char)terminator[matched]) matched++;
+    }
+    return true;
+}
+
+static void appendUTF8(string& out, unsigned long cp) {
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+static bool readEntity(XMLReader& r, string& out) {
+    string entity;
+    int c;
+    while ((c = r.get()) != ';') {
+        if (c < 0 || entity.size() > 10) return r.fail("Malformed entity");
+        entity += (char)c;
+    }
+    if (entity == "lt") out += '<';
+    else if (entity == "gt") out += '>';
+    else if (entity == "amp") out += '&';
+    else if (entity == "quot") out += '"';
+    else if (entity == "apos") out += '\'';
+    else if (entity.size() > 1 && entity[0] == '#') {
+        bool hex = entity[1] == 'x' || entity[1] == 'X';
+        appendUTF8(out, strtoul(entity.c_str() + (hex ? 2 : 1), nullptr, hex ? 16 : 10));
+    } else {
+        return r.fail("Unknown entity &" + entity + ";");
+    }
+    return true;
+}
+
+static bool readAttributeValue(XMLReader& r, string& out) {
+    out.clear();
+    int quote = r.get();
+    if (quote != '"' && quote != '\'') return r.fail("Expected a quoted attribute value");
+    for (;;) {
+        int c = r.get();
+        if (c < 0) return r.fail("Unterminated attribute value");
+        if (c == quote) return true;
+        if (c == '&') {
+            if (!readEntity(r, out)) return false;
+        } else {
+            out += (char)c;
+        }
+    }
+}
+
+// ============================================================================
+// MARKUP
+// ============================================================================
+
+/**
+ * <!-- comment -->, <![CDATA[ ... ]]> or <!DOCTYPE ...> (after the '!')
+ */
+static bool skipDeclaration(XMLReader& r) {
+    if (r.peek() == '-') {
+        r.get();
+        if (r.get() != '-') return r.fail("Malformed comment");
+        return skipPast(r, "-->");
+    }
+    if (r.peek() == '[') return skipPast(r, "]]>");
+    int depth = 0;  // DOCTYPE may hold an internal subset in brackets
+    for (;;) {
+        int c = r.get();
+        if (c < 0) return r.fail("Unterminated declaration");
+        if (c == '[') depth++;
+        else if (c == ']') depth--;
+        else if (c == '>' && depth <= 0) return true;
+    }
+}
+
+static bool readEndTag(XMLReader& r, XMLStreamHandler& handler) {
+    handler.line = r.line;
+    if (!readName(r, r.name)) return false;
+    skipSpace(r);
+    if (r.get() != '>') return r.fail("Expected '>' after </" + r.name);
+    if (r.open.empty() || r.open.back() != r.name) {
+        return r.fail("Mismatched closing tag </" + r.name + ">");
+    }
+    handler.endElement(r.name.c_str());
+    r.open.pop_back();
+    return true;
+}
+
+static bool readStartTag(XMLReader& r, XMLStreamHandler& handler, bool& sawRoot) {
+    if (r.open.empty() && sawRoot) return r.fail("More than one root element");
+    handler.line = r.line;
+    if (!readName(r, r.name)) return false;
+
+    size_t count = 0;
+    bool selfClosing = false;
+    for (;;) {
+        skipSpace(r);
+        int c = r.peek();
+        if (c == '>') {
+            r.get();
+            break;
+        }
+        if (c == '/') {
+            r.get();
+            if (r.get() != '>') return r.fail("Expected '>' after '/'");
+            selfClosing = true;
+            break;
+        }
+        if (c < 0) return r.fail("Unterminated tag <" + r.name);
+
+        if (count == r.attrNames.size()) {
+            r.attrNames.emplace_back();
+            r.attrValues.emplace_back();
+        }
+        if (!readName(r, r.attrNames[count])) return false;
+        skipSpace(r);
+        if (r.get() != '=') return r.fail("Expected '=' after attribute " + r.attrNames[count]);
+        skipSpace(r);
+        if (!readAttributeValue(r, r.attrValues[count])) return false;
+        count++;
+    }
+
+    // Point at the strings only once they stop moving
+    r.attrs.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        r.attrs[i].name = r.attrNames[i].c_str();
+        r.attrs[i].value = r.attrValues[i].c_str();
+    }
+
+    sawRoot = true;
+    handler.startElement(r.name.c_str(), r.attrs.data(), (int)count);
+    if (selfClosing) {
+        handler.endElement(r.name.c_str());
+    } else {
+        r.open.push_back(r.name);
+    }
+    return true;
+}
+
+// ============================================================================
+// ENTRY POINTS
+// ============================================================================
+
+bool streamXMLFile(const char* filename, XMLStreamHandler& handler, string& error) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        error = string("Could not open ") + filename;
+        return false;
+    }
+
+    // The reader holds the buffer, keep it off the stack
+    unique_ptr<XMLReader> reader(new XMLReader(file));
+    XMLReader& r = *reader;
+
+    bool ok = true;
+    bool sawRoot = false;
+    for (;;) {
+        int c = r.get();
+        if (c < 0) break;
+        if (c != '<') continue;  // text content is ignored
+
+        c = r.peek();
+        if (c == '?') {
+            ok = skipPast(r, "?>");
+        } else if (c == '!') {
+            r.get();
+            ok = skipDeclaration(r);
+        } else if (c == '/') {
+            r.get();
+            ok = readEndTag(r, handler);
+        } else {
+            ok = readStartTag(r, handler, sawRoot);
+        }
+        if (!ok) break;
+    }
+
+    if (ok && !r.open.empty()) ok = r.fail("Missing closing tag </" + r.open.back() + ">");
+    if (ok && !sawRoot) ok = r.fail("No root element");
+    fclose(file);
+
+    if (!ok) error = r.error;
+    return ok;
+}
+
+const char* findAttribute(const XMLStreamAttribute* attributes, int count, const char* name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(attributes[i].name, name) == 0) return attributes[i].value;
+    }
+    return nullptr;
+}
+
+float floatAttribute(const XMLStreamAttribute* attributes, int count, const char* name, float def) {
+    const char* value = findAttribute(attributes, count, name);
+    if (!value) return def;
+    char* end;
+    float f = strtof(value, &end);
+    return end == value ? def : f;
+}
+
+int intAttribute(const XMLStreamAttribute* attributes, int count, const char* name, int def) {
+    const char* value = findAttribute(attributes, count, name);
+    if (!value) return def;
+    char* end;
+    long i = strtol(value, &end, 10);
+    return end == value ? def : (int)i;
+}
+
+bool boolAttribute(const XMLStreamAttribute* attributes, int count, const char* name, bool def) {
+    const char* value = findAttribute(attributes, count, name);
+    if (!value) return def;
+    if (strcmp(value, "true") == 0 || strcmp(value, "1") == 0) return true;
+    if (strcmp(value, "false") == 0 || strcmp(value, "0") == 0) return false;
+    return def;
+}
@@ -0,0 +1,45 @@
+#ifndef XMLSTREAM_H
+#define XMLSTREAM_H
+
+#include <string>
+
+using namespace std;
+
+// ============================================================================
+// STREAMING XML READER
+// ============================================================================
+
+// Reads a file through a fixed-size buffer and reports elements as they are
+// found, so no document tree is ever built. Text content, comments,
+// processing instructions and DOCTYPE are skipped (configs only use
+// elements and attributes).
+
+struct XMLStreamAttribute {
+    const char* name;
+    const char* value;  // entities already decoded
+};
+
+struct XMLStreamHandler {
+    int line;  // line of the tag being reported
+    XMLStreamHandler() : line(0) {}
+    virtual ~XMLStreamHandler() {}
+    // Attribute strings are only valid for the duration of the call
+    virtual void startElement(const char* name, const XMLStreamAttribute* attributes, int count) = 0;
+    virtual void endElement(const char* name) = 0;
+};
+
+/**
+ * Stream a file into a handler; on malformed input returns false with a
+ * message (including the line number) in error
+ */
+bool streamXMLFile(const char* filename, XMLStreamHandler& handler, string& error);
+
+/**
+ * Attribute lookup helpers (return the default if missing or malformed)
+ */
+const char* findAttribute(const XMLStreamAttribute* attributes, int count, const char* name);
+float floatAttribute(const XMLStreamAttribute* attributes, int count, const char* name, float def);
+int intAttribute(const XMLStreamAttribute* attributes, int count, const char* name, int def);
+bool boolAttribute(const XMLStreamAttribute* attributes, int count, const char* name, bool def);
+
+#endif // XMLSTREAM_H
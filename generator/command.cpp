@@ -0,0 +1,280 @@
+#include "../include/generator_commands.h"
+#include "../include/figures.h"
+#include "../include/trace.h"
+#include <iostream>
+#include <list>
+#include <stdexcept>
+
+using namespace std;
+
+// ============================================================================
+// COMMANDS
+// ============================================================================
+
+void printGeneratorUsage(const char* program) {
+    cerr << "Usage: " << program << " [--trace <trace.json>] [-j <threads>] [--stats] [--binary] [--indexed] <shape> <parameters...> <output_file>" << endl;
+    cerr << "       " << program << " [--trace <trace.json>] [-j <threads>] [--stats] [--binary] --manifest <figures.txt>" << endl;
+    cerr << "Available shapes:" << endl;
+    cerr << "  sphere <radius> <slices> <stacks> <output_file>" << endl;
+    cerr << "  box <length> <divisions> <output_file>" << endl;
+    cerr << "  cone <radius> <height> <slices> <stacks> <output_file>" << endl;
+    cerr << "  plane <length> <divisions> <output_file>" << endl;
+    cerr << "  cylinder <radius> <height> <slices> <stacks> <output_file>" << endl;
+    cerr << "  icosphere <radius> <subdivisions> <output_file>" << endl;
+    cerr << "  torus <R> <r> <slices> <stacks> <output_file>" << endl;
+    cerr << "  ring <innerRadius> <outerRadius> <slices> <output_file>" << endl;
+    cerr << "  stars <shape> <num> <param1> <param2> <size1> <size2> <output_file>" << endl;
+    cerr << "  scatter <volume_shape> <volume_params...> <num> <model.3d> <scale_min> <scale_max> <output_file>" << endl;
+    cerr << "  scene <groups> <depth> <fanout> <models> <detail> <animated> <output.xml>" << endl;
+    cerr << "    volume_shape: sphere <r_min> <r_max>" << endl;
+    cerr << "                  torus  <R> <r_min> <r_max>" << endl;
+    cerr << "                  plane  <width> <height>" << endl;
+    cerr << "                  cylinder <r_min> <r_max> <h_min> <h_max>" << endl;
+    cerr << "                  box    <inner_half> <outer_half>" << endl;
+    cerr << "    --indexed writes unique vertices and triangle indices (icosphere)" << endl;
+    cerr << "    --manifest generates every figure listed in a file, one command per line, in parallel" << endl;
+    cerr << "    scene writes a synthetic config to configs/ and its <models> figures to figures/;" << endl;
+    cerr << "    <detail> is the slice count of each figure, <animated> the share of groups with a body (0-1)" << endl;
+}
+
+bool parseFigureCommand(const vector<string>& args, bool indexed, FigureCommand& command) {
+    if (args.size() < 2) {
+        cerr << "Error: a command needs a shape and an output file" << endl;
+        return false;
+    }
+    list<string> arglist(args.begin() + 1, args.end() - 1);
+    string figure = args.front();
+    string file   = args.back();
+    command = FigureCommand();
+    command.shape = figure;
+    command.output = file;
+
+    try {
+        // ── primitive shapes (unchanged) ────────────────────────────────────
+
+        if (figure == "sphere") {
+            if (arglist.size() != 3) { cerr << "Usage: sphere <radius> <slices> <stacks> <output_file>" << endl; return false; }
+            float radius = stof(arglist.front()); arglist.pop_front();
+            int slices   = stoi(arglist.front()); arglist.pop_front();
+            int stacks   = stoi(arglist.front());
+            if (!verifyMetric("radius", radius, 0.01) ||
+                !verifyMetric("slices", slices, 1)    ||
+                !verifyMetric("stacks", stacks, 1)) return false;
+            command.generate = [=](VertexSink& v, const vector<float>*) { generateSphere(radius, slices, stacks, v); return true; };
+
+        } else if (figure == "box") {
+            if (arglist.size() != 2) { cerr << "Usage: box <length> <divisions> <output_file>" << endl; return false; }
+            float length   = stof(arglist.front()); arglist.pop_front();
+            int   divisions = stoi(arglist.front());
+            if (!verifyMetric("length", length, 0.01) ||
+                !verifyMetric("divisions", divisions, 1)) return false;
+            command.generate = [=](VertexSink& v, const vector<float>*) { generateBox(length, divisions, v); return true; };
+
+        } else if (figure == "cone") {
+            if (arglist.size() != 4) { cerr << "Usage: cone <radius> <height> <slices> <stacks> <output_file>" << endl; return false; }
+            float radius = stof(arglist.front()); arglist.pop_front();
+            float height = stof(arglist.front()); arglist.pop_front();
+            int slices   = stoi(arglist.front()); arglist.pop_front();
+            int stacks   = stoi(arglist.front());
+            if (!verifyMetric("radius", radius, 0.01) ||
+                !verifyMetric("height", height, 0.01) ||
+                !verifyMetric("slices", slices, 1)    ||
+                !verifyMetric("stacks", stacks, 1)) return false;
+            command.generate = [=](VertexSink& v, const vector<float>*) { generateCone(radius, height, slices, stacks, v); return true; };
+
+        } else if (figure == "plane") {
+            if (arglist.size() != 2) { cerr << "Usage: plane <length> <divisions> <output_file>" << endl; return false; }
+            float length   = stof(arglist.front()); arglist.pop_front();
+            int   divisions = stoi(arglist.front());
+            if (!verifyMetric("length", length, 0.01) ||
+                !verifyMetric("divisions", divisions, 1)) return false;
+            command.generate = [=](VertexSink& v, const vector<float>*) { generatePlane(length, divisions, v); return true; };
+
+        } else if (figure == "cylinder") {
+            if (arglist.size() != 4) { cerr << "Usage: cylinder <radius> <height> <slices> <stacks> <output_file>" << endl; return false; }
+            float radius = stof(arglist.front()); arglist.pop_front();
+            float height = stof(arglist.front()); arglist.pop_front();
+            int slices   = stoi(arglist.front()); arglist.pop_front();
+            int stacks   = stoi(arglist.front());
+            if (!verifyMetric("radius", radius, 0.01) ||
+                !verifyMetric("height", height, 0.01) ||
+                !verifyMetric("slices", slices, 1)    ||
+                !verifyMetric("stacks", stacks, 1)) return false;
+            command.generate = [=](VertexSink& v, const vector<float>*) { generateCylinder(radius, height, slices, stacks, v); return true; };
+
+        } else if (figure == "icosphere") {
+            if (arglist.size() != 2) { cerr << "Usage: icosphere <radius> <subdivisions> <output_file>" << endl; return false; }
+            float radius      = stof(arglist.front()); arglist.pop_front();
+            int   subdivisions = stoi(arglist.front());
+            if (!verifyMetric("radius", radius, 0.01) ||
+                !verifyMetric("subdivisions", subdivisions, 0)) return false;
+            if (indexed) {
+                command.write = [=]() {
+                    vector<float> coords;
+                    vector<uint32_t> indices;
+                    buildIcosphere(radius, subdivisions, coords, indices);
+                    return writeIndexedFigure(file, coords, indices);
+                };
+                return true;
+            }
+            command.generate = [=](VertexSink& v, const vector<float>*) { generateIcosphere(radius, subdivisions, v); return true; };
+
+        } else if (figure == "torus") {
+            if (arglist.size() != 4) { cerr << "Usage: torus <R> <r> <slices> <stacks> <output_file>" << endl; return false; }
+            float R  = stof(arglist.front()); arglist.pop_front();
+            float r  = stof(arglist.front()); arglist.pop_front();
+            int slices = stoi(arglist.front()); arglist.pop_front();
+            int stacks = stoi(arglist.front());
+            command.generate = [=](VertexSink& v, const vector<float>*) { generateTorus(R, r, slices, stacks, v); return true; };
+
+        } else if (figure == "ring") {
+            if (arglist.size() != 3) { cerr << "Usage: ring <innerRadius> <outerRadius> <slices> <output_file>" << endl; return false; }
+            float innerR = stof(arglist.front()); arglist.pop_front();
+            float outerR = stof(arglist.front()); arglist.pop_front();
+            int   slices  = stoi(arglist.front());
+            if (!verifyMetric("innerRadius", innerR, 0.0f) ||
+                !verifyMetric("outerRadius", outerR, 0.01f) ||
+                !verifyMetric("slices", slices, 3)) return false;
+            command.generate = [=](VertexSink& v, const vector<float>*) { generateRing(innerR, outerR, slices, v); return true; };
+
+        // ── stars (legacy, kept for compatibility) ───────────────────────────
+        } else if (figure == "octahedron") {
+            if (arglist.size() != 1) { cerr << "Usage: octahedron <scale> <output_file>" << endl; return false; }
+            float scale = stof(arglist.front());
+            if (!verifyMetric("scale", scale, 0.01)) return false;
+            command.generate = [=](VertexSink& v, const vector<float>*) { generateOctahedron(v, 0.0f, 0.0f, 0.0f, scale); return true; };
+
+        // ── scene — synthetic config for scaling experiments ─────────────────
+        } else if (figure == "scene") {
+            if (arglist.size() != 6) { cerr << "Usage: scene <groups> <depth> <fanout> <models> <detail> <animated> <output.xml>" << endl; return false; }
+            int   groups   = stoi(arglist.front()); arglist.pop_front();
+            int   depth    = stoi(arglist.front()); arglist.pop_front();
+            int   fanout   = stoi(arglist.front()); arglist.pop_front();
+            int   models   = stoi(arglist.front()); arglist.pop_front();
+            int   detail   = stoi(arglist.front()); arglist.pop_front();
+            float animated = stof(arglist.front());
+            if (!verifyMetric("groups", groups, 1) ||
+                !verifyMetric("depth", depth, 1)   ||
+                !verifyMetric("fanout", fanout, 1) ||
+                !verifyMetric("models", models, 1) ||
+                !verifyMetric("detail", detail, 3) ||
+                !verifyMetric("animated", animated, 0.0f)) return false;
+            if (animated > 1.0f) { cerr << "Error: animated must be at most 1 (got " << animated << ")" << endl; return false; }
+            command.exclusive = true;
+            command.write = [=]() { return generateScene(groups, depth, fanout, models, detail, animated, file); };
+            return true;
+
+        // ── scatter — meta-generator ─────────────────────────────────────────
+        } else if (figure == "scatter") {
+            /*
+             * scatter <volume_shape> <volume_params...> <num> <model.3d> <scale_min> <scale_max>
+             *
+             * volume_shape  params needed
+             * ------------  --------------------------
+             * sphere        r_min r_max
+             * torus         R r_min r_max
+             * plane         width height
+             * cylinder      r_min r_max h_min h_max
+             * box           inner_half outer_half
+             *
+             * Examples:
+             *   scatter sphere 450 490 1000 octahedron.3d 0.3 0.8 stars.3d
+             *   scatter torus 110 8 15 200 asteroid.3d 0.5 2.0 belt_main.3d
+             *   scatter torus 290 12 25 500 asteroid.3d 0.3 3.0 belt_kuiper.3d
+             */
+            if (arglist.empty()) {
+                cerr << "scatter: missing volume shape" << endl; return false;
+            }
+
+            string shape = arglist.front(); arglist.pop_front();
+
+            int numParams = 0;
+            if      (shape == "sphere")   numParams = 2;
+            else if (shape == "torus")    numParams = 3;
+            else if (shape == "plane")    numParams = 2;
+            else if (shape == "cylinder") numParams = 4;
+            else if (shape == "box")      numParams = 2;
+            else { cerr << "scatter: unknown volume shape '" << shape << "'" << endl; return false; }
+
+            if ((int)arglist.size() < numParams + 4) {
+                cerr << "scatter: not enough arguments for shape '" << shape << "'" << endl;
+                return false;
+            }
+
+            vector<float> params;
+            for (int i = 0; i < numParams; i++) {
+                params.push_back(stof(arglist.front()));
+                arglist.pop_front();
+            }
+
+            int    num       = stoi(arglist.front()); arglist.pop_front();
+            string modelFile =      arglist.front();  arglist.pop_front();
+            float  scaleMin  = stof(arglist.front()); arglist.pop_front();
+            float  scaleMax  = stof(arglist.front()); arglist.pop_front();
+
+            command.model = modelFile;
+            command.generate = [=](VertexSink& v, const vector<float>* model) {
+                if (model) return generateScatter(shape, params, *model, scaleMin, scaleMax, num, v);
+                return generateScatter(shape, params, modelFile, scaleMin, scaleMax, num, v);
+            };
+
+        } else {
+            cerr << "Unknown figure type: " << figure << endl;
+            cerr << "Available shapes: sphere, box, cone, plane, cylinder, icosphere, torus, ring, stars, scatter, scene" << endl;
+            return false;
+        }
+    } catch (const logic_error&) {
+        // stoi / stof on a parameter that is not a number
+        cerr << "Error: invalid number in the parameters of " << figure << endl;
+        return false;
+    }
+
+    if (indexed) {
+        cerr << "Error: --indexed is only supported for icosphere" << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Passes vertices on to a writer and keeps a copy (a manifest figure that
+ * later figures read)
+ */
+class CaptureSink : public VertexSink {
+public:
+    CaptureSink(VertexSink& out, vector<float>& copy) : out(out), copy(copy) {}
+    void vertex(float x, float y, float z) override {
+        out.vertex(x, y, z);
+        copy.push_back(x);
+        copy.push_back(y);
+        copy.push_back(z);
+    }
+    void vertexBlock(const float* xyz, size_t count) override {
+        out.vertexBlock(xyz, count);
+        copy.insert(copy.end(), xyz, xyz + count * 3);
+    }
+private:
+    VertexSink& out;
+    vector<float>& copy;
+};
+
+bool runFigureCommand(const FigureCommand& command, const vector<float>* model, vector<float>* capture) {
+    TraceScope trace("generate", "generator", command.output.c_str());
+    if (command.write) return command.write();
+
+    // Vertices go to the file as they are generated
+    FigureWriter writer;
+    if (!writer.open(command.output)) return false;
+    bool generated;
+    if (capture) {
+        CaptureSink tee(writer, *capture);
+        generated = command.generate(tee, model);
+    } else {
+        generated = command.generate(writer, model);
+    }
+    if (!generated) {
+        writer.discard();
+        return false;
+    }
+    return writer.close();
+}
@@ -1,20 +1,18 @@
-#include <list>
 #include <string>
 #include <cmath>
 #include "../include/generator_helpers.h"
+#include "../include/parametric.h"
 using namespace std;
 
-void generateCylinder(float radius, float height, int slices, int stacks, list<string>& vertices) {
-    float sliceStep = (2 * M_PI) / slices;
+void generateCylinder(float radius, float height, int slices, int stacks, VertexSink& vertices) {
+    TrigTable theta(slices, (2 * M_PI) / slices);
     float stackStep = height / stacks;
 
     for (int i = 0; i < slices; i++) {
-        float theta1 = i * sliceStep;
-        float theta2 = (i + 1) * sliceStep;
-        float x1 = radius * cos(theta1);
-        float z1 = radius * sin(theta1);
-        float x2 = radius * cos(theta2);
-        float z2 = radius * sin(theta2);
+        float x1 = radius * theta.cosv[i];
+        float z1 = radius * theta.sinv[i];
+        float x2 = radius * theta.cosv[i + 1];
+        float z2 = radius * theta.sinv[i + 1];
 
         // Bottom cap
         generateTriangle(vertices, x1, 0, z1, x2, 0, z2, 0, 0, 0);
@@ -23,24 +21,24 @@ void generateCylinder(float radius, float height, int slices, int stacks, list<s
         generateTriangle(vertices, x1, height, z1, 0, height, 0, x2, height, z2);
     }
 
-    // Side wall subdivided by stacks
-    for (int j = 0; j < stacks; j++) {
-        float y_low  = j * stackStep;
-        float y_high = (j + 1) * stackStep;
-
+    // Side wall subdivided by stacks; row j is the circle at y = j * stackStep
+    auto evalRow = [&](int j, GridRow& row) {
+        float y = j * stackStep;
+        for (int i = 0; i <= slices; i++) {
+            row.x[i] = radius * theta.cosv[i];
+            row.y[i] = y;
+            row.z[i] = radius * theta.sinv[i];
+        }
+    };
+    auto emitBand = [&](int, const GridRow& low, const GridRow& high, VertexSink& out) {
         for (int i = 0; i < slices; i++) {
-            float theta1 = i * sliceStep;
-            float theta2 = (i + 1) * sliceStep;
-            float x1 = radius * cos(theta1);
-            float z1 = radius * sin(theta1);
-            float x2 = radius * cos(theta2);
-            float z2 = radius * sin(theta2);
-
-            generateQuad(vertices,
-                x2, y_low,  z2,
-                x1, y_low,  z1,
-                x2, y_high, z2,
-                x1, y_high, z1);
+            generateQuad(out,
+                low.x[i + 1],  low.y[i + 1],  low.z[i + 1],
+                low.x[i],      low.y[i],      low.z[i],
+                high.x[i + 1], high.y[i + 1], high.z[i + 1],
+                high.x[i],     high.y[i],     high.z[i]);
         }
-    }
+    };
+    auto bandVertices = [&](int) { return 6 * (size_t)slices; };
+    sweepGrid(stacks, slices, evalRow, bandVertices, emitBand, vertices);
 }
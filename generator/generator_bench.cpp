@@ -0,0 +1,221 @@
+// ============================================================================
+// GENERATOR BENCHMARK
+// ============================================================================
+// Times every primitive and scatter over a sweep of tessellation parameters,
+// output file included. Besides time per run each benchmark reports
+// vertices/s, the share of the run spent on geometry, vertex formatting and
+// file I/O, and the peak memory of the benchmark (on Linux the peak is
+// reset before each one; elsewhere it is the process's peak so far).
+// Figures are written to a temporary directory laid out like the repo.
+//
+// Usage: generator_bench [--benchmark_filter=<regex>] [--benchmark_repetitions=<n>]
+//                        [--benchmark_out=<file.json> --benchmark_out_format=json]
+// ============================================================================
+
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "../include/figures.h"
+#include "../include/generator_helpers.h"
+#include "../include/generator_stats.h"
+
+using namespace std;
+
+static string benchRoot;
+
+// Figure the scatter benchmark copies
+static const char* SCATTER_MODEL = "bench_octahedron.3d";
+
+static bool makeBenchTree() {
+    char root[] = "/tmp/generator_bench.XXXXXX";
+    if (!mkdtemp(root)) return false;
+    benchRoot = root;
+    mkdir((benchRoot + "/figures").c_str(), 0755);
+    mkdir((benchRoot + "/build").c_str(), 0755);
+    mkdir((benchRoot + "/build/bench").c_str(), 0755);
+    // Figures are written to ../../figures, as from generator/build
+    return chdir((benchRoot + "/build/bench").c_str()) == 0;
+}
+
+static void removeBenchTree() {
+    if (chdir("/") != 0) return;
+    string command = "rm -rf '" + benchRoot + "'";
+    if (system(command.c_str()) != 0) {
+        cerr << "Could not remove " << benchRoot << endl;
+    }
+}
+
+/**
+ * Silences cout for a scope (FigureWriter reports every figure)
+ */
+struct QuietOutput {
+    ostringstream sink;
+    streambuf* saved;
+    QuietOutput() : saved(cout.rdbuf(sink.rdbuf())) {}
+    ~QuietOutput() { cout.rdbuf(saved); }
+};
+
+/**
+ * Generate into a FigureWriter once per iteration and report the split
+ * (summed over iterations, so the shares are averages)
+ */
+static void runFigure(benchmark::State& state, const function<bool(VertexSink&)>& generate) {
+    QuietOutput quiet;
+    generatorStats.enabled = true;
+#ifdef __GLIBC__
+    malloc_trim(0);  // hand the previous benchmark's heap back, so its peak is not carried over
+#endif
+    resetGeneratorStats();
+    double totalMs = 0.0;
+    for (auto _ : state) {
+        double startMs = generatorClockMs();
+        FigureWriter vertices;
+        if (!vertices.open("bench_output.3d") || !generate(vertices) || !vertices.close()) {
+            state.SkipWithError("generation failed");
+            break;
+        }
+        totalMs += generatorClockMs() - startMs;
+        // Truncating a large previous output would be charged to the next write
+        state.PauseTiming();
+        unlink("../../figures/bench_output.3d");
+        state.ResumeTiming();
+    }
+    const GeneratorStats& s = generatorStats;
+    double share = totalMs > 0.0 ? 1.0 / totalMs : 0.0;
+    double geometryMs = totalMs - s.formatMs - s.ioMs;
+    state.counters["vertices"] = benchmark::Counter(state.iterations() ? s.vertices / state.iterations() : 0);
+    state.counters["vertices_per_second"] = benchmark::Counter(s.vertices, benchmark::Counter::kIsRate);
+    state.counters["geometry_share"] = geometryMs > 0.0 ? geometryMs * share : 0.0;
+    state.counters["format_share"] = s.formatMs * share;
+    state.counters["io_share"] = s.ioMs * share;
+    state.counters["peak_rss_mb"] = generatorPeakMemoryMB();
+    generatorStats.enabled = false;
+}
+
+// ============================================================================
+// PRIMITIVES
+// ============================================================================
+
+static void BM_Sphere(benchmark::State& state) {
+    int slices = state.range(0);
+    runFigure(state, [=](VertexSink& v) { generateSphere(1.0f, slices, slices / 2, v); return true; });
+}
+BENCHMARK(BM_Sphere)->ArgName("slices")->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+
+static void BM_Box(benchmark::State& state) {
+    int divisions = state.range(0);
+    runFigure(state, [=](VertexSink& v) { generateBox(2.0f, divisions, v); return true; });
+}
+BENCHMARK(BM_Box)->ArgName("divisions")->RangeMultiplier(4)->Range(4, 256)->Unit(benchmark::kMillisecond);
+
+static void BM_Plane(benchmark::State& state) {
+    int divisions = state.range(0);
+    runFigure(state, [=](VertexSink& v) { generatePlane(2.0f, divisions, v); return true; });
+}
+BENCHMARK(BM_Plane)->ArgName("divisions")->RangeMultiplier(4)->Range(4, 512)->Unit(benchmark::kMillisecond);
+
+static void BM_Cone(benchmark::State& state) {
+    int slices = state.range(0);
+    runFigure(state, [=](VertexSink& v) { generateCone(1.0f, 2.0f, slices, slices / 2, v); return true; });
+}
+BENCHMARK(BM_Cone)->ArgName("slices")->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+
+static void BM_Cylinder(benchmark::State& state) {
+    int slices = state.range(0);
+    runFigure(state, [=](VertexSink& v) { generateCylinder(1.0f, 2.0f, slices, slices / 2, v); return true; });
+}
+BENCHMARK(BM_Cylinder)->ArgName("slices")->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+
+static void BM_Torus(benchmark::State& state) {
+    int slices = state.range(0);
+    runFigure(state, [=](VertexSink& v) { generateTorus(1.0f, 0.3f, slices, slices / 2, v); return true; });
+}
+BENCHMARK(BM_Torus)->ArgName("slices")->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+
+static void BM_Ring(benchmark::State& state) {
+    int slices = state.range(0);
+    runFigure(state, [=](VertexSink& v) { generateRing(0.5f, 1.0f, slices, v); return true; });
+}
+BENCHMARK(BM_Ring)->ArgName("slices")->RangeMultiplier(8)->Range(16, 65536)->Unit(benchmark::kMillisecond);
+
+static void BM_Icosphere(benchmark::State& state) {
+    int subdivisions = state.range(0);
+    runFigure(state, [=](VertexSink& v) { generateIcosphere(1.0f, subdivisions, v); return true; });
+}
+BENCHMARK(BM_Icosphere)->ArgName("subdivisions")->DenseRange(1, 7, 2)->Unit(benchmark::kMillisecond);
+
+/**
+ * Counts vertices and drops them, so a benchmark times the geometry alone
+ */
+class CountingSink : public VertexSink {
+public:
+    size_t count = 0;
+    void vertex(float, float, float) override { count++; }
+    void vertexBlock(const float*, size_t n) override { count += n; }
+};
+
+// -j 1 against -j 4 on a sphere too fine for one base face per thread
+static void BM_IcosphereThreads(benchmark::State& state) {
+    int subdivisions = state.range(0);
+    generatorThreads = state.range(1);
+    size_t vertices = 0;
+    for (auto _ : state) {
+        CountingSink sink;
+        generateIcosphere(1.0f, subdivisions, sink);
+        vertices = sink.count;
+    }
+    generatorThreads = 0;
+    state.counters["vertices"] = benchmark::Counter(vertices);
+    state.counters["vertices_per_second"] =
+        benchmark::Counter((double)vertices * state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_IcosphereThreads)->ArgNames({"subdivisions", "threads"})
+    ->Args({9, 1})->Args({9, 4})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_Octahedron(benchmark::State& state) {
+    runFigure(state, [](VertexSink& v) { generateOctahedron(v, 0.0f, 0.0f, 0.0f, 1.0f); return true; });
+}
+BENCHMARK(BM_Octahedron)->Unit(benchmark::kMicrosecond);
+
+// ============================================================================
+// SCATTER
+// ============================================================================
+
+static void BM_Scatter(benchmark::State& state) {
+    int num = state.range(0);
+    vector<float> params = { 110.0f, 8.0f, 15.0f };
+    runFigure(state, [&](VertexSink& v) {
+        return generateScatter("torus", params, SCATTER_MODEL, 0.5f, 2.0f, num, v);
+    });
+}
+BENCHMARK(BM_Scatter)->ArgName("instances")->RangeMultiplier(10)->Range(100, 100000)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    if (!makeBenchTree()) {
+        cerr << "Could not create the benchmark output directory under /tmp" << endl;
+        return 1;
+    }
+    {
+        // The figure scatter copies
+        QuietOutput quiet;
+        FigureWriter vertices;
+        if (!vertices.open(SCATTER_MODEL)) return 1;
+        generateOctahedron(vertices, 0.0f, 0.0f, 0.0f, 1.0f);
+        vertices.close();
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    removeBenchTree();
+    return 0;
+}
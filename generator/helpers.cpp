@@ -0,0 +1,492 @@
+#include "../include/generator_helpers.h"
+#include "../include/generator_stats.h"
+#include "../include/figure_format.h"
+#include "../include/trace.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <sys/resource.h>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+using namespace std;
+
+GeneratorStats generatorStats;
+mutex generatorReportLock;
+bool binaryFigures = false;
+int generatorThreads = 0;
+static thread_local bool serialThread = false;
+
+// ============================================================================
+// HELPER FUNCTIONS
+// ============================================================================
+
+void addVertex(VertexSink& vertices, float x, float y, float z) {
+    vertices.vertex(x, y, z);
+}
+
+void generateTriangle(VertexSink& vertices,
+                      float x1, float y1, float z1,
+                      float x2, float y2, float z2,
+                      float x3, float y3, float z3) {
+    vertices.vertex(x1, y1, z1);
+    vertices.vertex(x2, y2, z2);
+    vertices.vertex(x3, y3, z3);
+}
+
+void generateQuad(VertexSink& vertices,
+                    float x1, float y1, float z1,
+                    float x2, float y2, float z2,
+                    float x3, float y3, float z3,
+                    float x4, float y4, float z4) {
+    generateTriangle(vertices, x1, y1, z1, x2, y2, z2, x4, y4, z4);
+    generateTriangle(vertices, x1, y1, z1, x4, y4, z4, x3, y3, z3);
+}
+
+bool verifyMetric(const string& name, float value, float min) {
+    if (value < min) {
+        cerr << "Error: " << name << " must be at least " << min
+             << " (got " << value << ")" << endl;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// FILE I/O
+// ============================================================================
+
+static const size_t WRITE_BUFFER_BYTES = 1 << 20;
+static const size_t MAX_VERTEX_BYTES = 3 * 32;  // text line of three floats, with room to spare
+static const int COUNT_FIELD_WIDTH = 20;        // padded text header, fits any 64-bit count
+static const size_t PENDING_VERTICES = 4096;    // single vertices staged before formatting
+
+/**
+ * Shortest decimal form of v that reads back as the same float
+ */
+static char* formatFloat(char* out, float v) {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    return to_chars(out, out + 32, v).ptr;
+#else
+    // No floating-point to_chars: the fewest %g digits (9 always suffice) that round-trip
+    for (int digits = 6; ; digits++) {
+        int n = snprintf(out, 32, "%.*g", digits, v);
+        if (digits == 9 || strtof(out, NULL) == v) return out + n;
+    }
+#endif
+}
+
+FigureWriter::FigureWriter()
+    : out(NULL), binary(binaryFigures), failed(false), headerWritten(false), vertexCount(0), used(0),
+      formatMs(0.0), ioMs(0.0) {}
+
+FigureWriter::~FigureWriter() {
+    if (out) fclose(out);
+}
+
+bool FigureWriter::open(const string& file) {
+    formatMs = ioMs = 0.0;
+    StatsScope timing(ioMs, NULL);
+    path = "../../figures/" + file;
+    out = fopen(path.c_str(), "wb");
+    if (!out) {
+        cerr << "Error: Could not open file " << path << endl;
+        cerr << "Make sure the 'figures' directory exists!" << endl;
+        return false;
+    }
+    setvbuf(out, NULL, _IONBF, 0);  // the writer's own buffer is the only copy
+    buffer.resize(WRITE_BUFFER_BYTES);
+    if (!binary) pending.reserve(PENDING_VERTICES * 3);
+    failed = false;
+    headerWritten = false;
+    vertexCount = 0;
+    used = 0;
+    if (binary) {
+        // Placeholder, filled in by close()
+        FigureBinaryHeader header = {};
+        memcpy(&buffer[0], &header, sizeof(header));
+        used = sizeof(header);
+    }
+    return true;
+}
+
+void FigureWriter::vertex(float x, float y, float z) {
+    if (binary) {
+        if (used + MAX_VERTEX_BYTES > buffer.size()) flush();
+        float v[3] = { x, y, z };
+        memcpy(&buffer[used], v, sizeof(v));
+        used += sizeof(v);
+    } else {
+        // Formatted in batches, so --stats times batches rather than vertices
+        pending.push_back(x);
+        pending.push_back(y);
+        pending.push_back(z);
+        if (pending.size() == PENDING_VERTICES * 3) formatPending();
+    }
+    vertexCount++;
+}
+
+void FigureWriter::vertexBlock(const float* xyz, size_t count) {
+    if (binary) {
+        // Straight copies, in buffer-sized pieces
+        size_t bytes = count * 3 * sizeof(float);
+        const char* data = (const char*)xyz;
+        while (bytes > 0) {
+            if (used == buffer.size()) flush();
+            size_t n = min(bytes, buffer.size() - used);
+            memcpy(&buffer[used], data, n);
+            used += n;
+            data += n;
+            bytes -= n;
+        }
+    } else {
+        formatPending();
+        formatBlock(xyz, count);
+    }
+    vertexCount += count;
+}
+
+void FigureWriter::formatPending() {
+    formatBlock(pending.data(), pending.size() / 3);
+    pending.clear();
+}
+
+/**
+ * Text lines of count vertices into the buffer, timed once per buffer fill
+ */
+void FigureWriter::formatBlock(const float* xyz, size_t count) {
+    size_t i = 0;
+    while (i < count) {
+        if (used + MAX_VERTEX_BYTES > buffer.size()) flush();
+        StatsScope timing(formatMs, NULL);
+        for (; i < count && used + MAX_VERTEX_BYTES <= buffer.size(); i++, xyz += 3)
+            formatVertex(xyz[0], xyz[1], xyz[2]);
+    }
+}
+
+void FigureWriter::formatVertex(float x, float y, float z) {
+    char* start = &buffer[0];
+    char* p = start + used;
+    p = formatFloat(p, x);
+    *p++ = ' ';
+    p = formatFloat(p, y);
+    *p++ = ' ';
+    p = formatFloat(p, z);
+    *p++ = '\n';
+    used = p - start;
+}
+
+void FigureWriter::writeBlock(const char* data, size_t size) {
+    if (size > 0 && fwrite(data, 1, size, out) != size) failed = true;
+}
+
+void FigureWriter::flush() {
+    StatsScope timing(ioMs, NULL);
+    if (!headerWritten && !binary) {
+        // The count is not known yet: reserve a fixed-width first line
+        string placeholder(COUNT_FIELD_WIDTH, ' ');
+        placeholder += '\n';
+        writeBlock(placeholder.data(), placeholder.size());
+    }
+    headerWritten = true;  // the binary placeholder is at the start of the buffer
+    writeBlock(buffer.data(), used);
+    used = 0;
+}
+
+bool FigureWriter::close() {
+    if (!out) return false;
+    TraceScope trace("writeFigure", "generator", path.c_str());
+    if (!binary) formatPending();
+    {
+        StatsScope timing(ioMs, NULL);
+        FigureBinaryHeader header = {};
+        memcpy(header.magic, FIGURE_BINARY_MAGIC, sizeof(header.magic));
+        header.vertexCount = vertexCount;
+        char text[32];
+        if (!headerWritten) {
+            // Everything fit in the buffer: the header goes out exact
+            if (binary) {
+                memcpy(&buffer[0], &header, sizeof(header));
+            } else {
+                int n = snprintf(text, sizeof(text), "%zu\n", vertexCount);
+                writeBlock(text, n);
+            }
+            writeBlock(buffer.data(), used);
+        } else {
+            writeBlock(buffer.data(), used);
+            if (fseek(out, 0, SEEK_SET) != 0) failed = true;
+            if (binary) {
+                writeBlock((const char*)&header, sizeof(header));
+            } else {
+                int n = snprintf(text, sizeof(text), "%-*zu\n", COUNT_FIELD_WIDTH, vertexCount);
+                writeBlock(text, n);
+            }
+        }
+        if (fclose(out) != 0) failed = true;
+        out = NULL;
+        vector<char>().swap(buffer);
+        vector<float>().swap(pending);
+    }
+    lock_guard<mutex> guard(generatorReportLock);
+    generatorStats.formatMs += formatMs;
+    generatorStats.ioMs += ioMs;
+    if (failed) {
+        cerr << "Error: Could not write " << path << endl;
+        return false;
+    }
+    generatorStats.vertices += vertexCount;
+    cout << "Figure generated successfully: " << path << endl;
+    cout << "Total: " << vertexCount << " vertices ("
+         << vertexCount / 3 << " triangles)" << endl;
+    return true;
+}
+
+void FigureWriter::discard() {
+    if (!out) return;
+    fclose(out);
+    out = NULL;
+    remove(path.c_str());
+    vector<char>().swap(buffer);
+    vector<float>().swap(pending);
+}
+
+bool writeIndexedFigure(const string& file, const vector<float>& coords, const vector<uint32_t>& indices) {
+    TraceScope trace("writeIndexedFigure", "generator", file.c_str());
+    StatsScope timing(generatorStats.ioMs);
+    string path = "../../figures/" + file;
+    FILE* out = fopen(path.c_str(), "wb");
+    if (!out) {
+        cerr << "Error: Could not open file " << path << endl;
+        cerr << "Make sure the 'figures' directory exists!" << endl;
+        return false;
+    }
+    FigureBinaryHeader header = {};
+    memcpy(header.magic, FIGURE_INDEXED_MAGIC, sizeof(header.magic));
+    header.vertexCount = coords.size() / 3;
+    uint64_t indexCount = indices.size();
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              fwrite(&indexCount, sizeof(indexCount), 1, out) == 1 &&
+              fwrite(coords.data(), sizeof(float), coords.size(), out) == coords.size() &&
+              fwrite(indices.data(), sizeof(uint32_t), indices.size(), out) == indices.size();
+    if (fclose(out) != 0) ok = false;
+    if (!ok) {
+        cerr << "Error: Could not write " << path << endl;
+        return false;
+    }
+    lock_guard<mutex> guard(generatorReportLock);
+    generatorStats.vertices += indices.size();
+    cout << "Figure generated successfully: " << path << endl;
+    cout << "Total: " << header.vertexCount << " unique vertices, " << indices.size() << " indices ("
+         << indices.size() / 3 << " triangles)" << endl;
+    return true;
+}
+
+bool readFigure(const string& file, vector<float>& coords) {
+    TraceScope trace("readFigure", "generator", file.c_str());
+    StatsScope timing(generatorStats.ioMs);
+    string path = "../../figures/" + file;
+    ifstream in(path, ios::binary);
+    if (!in.is_open()) {
+        cerr << "Error: Could not open model file " << path << endl;
+        return false;
+    }
+
+    in.seekg(0, ios::end);
+    uint64_t fileBytes = (uint64_t)in.tellg();
+    in.seekg(0);
+
+    FigureBinaryHeader header;
+    if (in.read((char*)&header, sizeof(header)) && isBinaryFigureHeader(header)) {
+        if (!figureFitsFile(header, 0, fileBytes)) {
+            cerr << "Error: " << path << " is shorter than its header says" << endl;
+            return false;
+        }
+        coords.resize(header.vertexCount * 3);
+        if (!in.read((char*)coords.data(), coords.size() * sizeof(float))) {
+            cerr << "Error: Could not read " << path << endl;
+            return false;
+        }
+        return true;
+    }
+    if (in && isIndexedFigureHeader(header)) {
+        uint64_t indexCount = 0;
+        if (!in.read((char*)&indexCount, sizeof(indexCount)) ||
+            !figureFitsFile(header, indexCount, fileBytes)) {
+            cerr << "Error: " << path << " is shorter than its header says" << endl;
+            return false;
+        }
+        if (indexCount % 3 != 0) {
+            cerr << "Error: " << path << " has " << indexCount << " indices, not whole triangles" << endl;
+            return false;
+        }
+        vector<float> unique(header.vertexCount * 3);
+        vector<uint32_t> indices(indexCount);
+        if (!in.read((char*)unique.data(), unique.size() * sizeof(float)) ||
+            !in.read((char*)indices.data(), indices.size() * sizeof(uint32_t))) {
+            cerr << "Error: Could not read " << path << endl;
+            return false;
+        }
+        for (uint32_t i : indices) {
+            if (i >= header.vertexCount) {
+                cerr << "Error: " << path << " has an index out of range (" << i << " of "
+                     << header.vertexCount << " vertices)" << endl;
+                return false;
+            }
+        }
+        coords.reserve(indices.size() * 3);
+        for (uint32_t i : indices) coords.insert(coords.end(), &unique[i * 3], &unique[i * 3] + 3);
+        return true;
+    }
+
+    in.clear();
+    in.seekg(0);
+    string line;
+    getline(in, line);  // vertex count
+    while (getline(in, line)) {
+        const char* p = line.c_str();
+        char* end;
+        float v[3];
+        int i = 0;
+        for (; i < 3; i++, p = end) {
+            v[i] = strtof(p, &end);
+            if (end == p) break;
+        }
+        if (i == 3) coords.insert(coords.end(), v, v + 3);
+    }
+    return true;
+}
+
+// ============================================================================
+// WORKER THREADS
+// ============================================================================
+
+void generateSeriallyOnThisThread() {
+    serialThread = true;
+}
+
+int generatorWorkerCount() {
+    if (serialThread) return 1;
+    if (generatorThreads > 0) return generatorThreads;
+    unsigned hw = thread::hardware_concurrency();
+    return hw > 0 ? (int)hw : 1;
+}
+
+void parallelFor(size_t count, const function<void(size_t, size_t)>& fn) {
+    size_t workers = min((size_t)generatorWorkerCount(), count);
+    if (workers <= 1) {
+        if (count > 0) fn(0, count);
+        return;
+    }
+    vector<thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t w = 1; w < workers; w++) {
+        threads.emplace_back(fn, count * w / workers, count * (w + 1) / workers);
+    }
+    fn(0, count / workers);
+    for (thread& t : threads) t.join();
+}
+
+static const size_t GENERATE_BLOCK_FLOATS = 1 << 22;  // vertices held per parallel block (16 MB)
+
+/**
+ * Writes vertices into a preallocated range
+ */
+class RangeSink : public VertexSink {
+public:
+    explicit RangeSink(float* start) : out(start) {}
+    void vertex(float x, float y, float z) override {
+        out[0] = x; out[1] = y; out[2] = z;
+        out += 3;
+    }
+private:
+    float* out;
+};
+
+void generateInOrder(size_t count, const function<size_t(size_t)>& itemVertices,
+                     const function<void(size_t, size_t, VertexSink&)>& emitRange,
+                     VertexSink& vertices) {
+    if (generatorWorkerCount() <= 1 || count <= 1) {
+        emitRange(0, count, vertices);
+        return;
+    }
+    vector<float> block;
+    vector<size_t> offsets;  // float offset of each item in the block
+    for (size_t first = 0; first < count; ) {
+        // At least one item per block, however large
+        size_t floats = 0;
+        size_t last = first;
+        offsets.clear();
+        while (last < count && (last == first || floats + itemVertices(last) * 3 <= GENERATE_BLOCK_FLOATS)) {
+            offsets.push_back(floats);
+            floats += itemVertices(last) * 3;
+            last++;
+        }
+        block.resize(floats);
+        parallelFor(last - first, [&](size_t begin, size_t end) {
+            RangeSink range(block.data() + offsets[begin]);
+            emitRange(first + begin, first + end, range);
+        });
+        vertices.vertexBlock(block.data(), floats / 3);
+        first = last;
+    }
+}
+
+// ============================================================================
+// STATS
+// ============================================================================
+
+void resetGeneratorStats() {
+    bool enabled = generatorStats.enabled;
+    generatorStats = GeneratorStats();
+    generatorStats.enabled = enabled;
+#ifdef __linux__
+    // Restart the peak from the current resident size
+    ofstream clearRefs("/proc/self/clear_refs");
+    if (clearRefs.is_open()) clearRefs << "5" << endl;
+#endif
+}
+
+double generatorPeakMemoryMB() {
+#ifdef __linux__
+    // VmHWM follows resets through clear_refs, ru_maxrss does not
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, 6, "VmHWM:") == 0) return atof(line.c_str() + 6) / 1024.0;
+    }
+#endif
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);  // bytes
+#else
+    return usage.ru_maxrss / 1024.0;             // KB
+#endif
+}
+
+void printGeneratorStats(double totalMs, ostream& out) {
+    const GeneratorStats& s = generatorStats;
+    // Formatting and I/O are summed over the threads that ran them; with a
+    // manifest those overlap, so the split is of the summed figure time
+    double splitMs = s.figureMs > 0.0 ? s.figureMs : totalMs;
+    double geometryMs = splitMs - s.formatMs - s.ioMs;
+    if (geometryMs < 0.0) geometryMs = 0.0;
+    double share = splitMs > 0.0 ? 100.0 / splitMs : 0.0;
+    out << fixed << setprecision(1);
+    out << "Stats: " << s.vertices << " vertices in " << totalMs << " ms ("
+        << (totalMs > 0.0 ? s.vertices / totalMs * 1000.0 : 0.0) << " vertices/s)" << endl;
+    if (s.figureMs > 0.0) {
+        out << "  thread time" << setw(10) << s.figureMs << " ms  (summed over the figure threads)" << endl;
+    }
+    out << "  geometry   " << setw(10) << geometryMs << " ms  " << setw(5) << geometryMs * share << "%" << endl;
+    out << "  formatting " << setw(10) << s.formatMs << " ms  " << setw(5) << s.formatMs * share << "%" << endl;
+    out << "  file I/O   " << setw(10) << s.ioMs << " ms  " << setw(5) << s.ioMs * share << "%" << endl;
+    out << "  peak memory " << generatorPeakMemoryMB() << " MB" << endl;
+    out << defaultfloat << setprecision(6);
+}
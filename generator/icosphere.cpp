@@ -1,7 +1,9 @@
-#include <list>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <cmath>
+#include <algorithm>
+#include "../include/figures.h"
 #include "../include/generator_helpers.h"
 
 using namespace std;
@@ -16,58 +18,137 @@ struct Point3D {
     }
 };
 
-void generateIcosphere(float radius, int subdivisions, list<string>& vertices) {
-    const float t = (1.0f + sqrt(5.0f)) / 2.0f;
-    vector<Point3D> baseVertices = {
-        Point3D(-1,  t,  0).normalize(radius),
-        Point3D( 1,  t,  0).normalize(radius),
-        Point3D(-1, -t,  0).normalize(radius),
-        Point3D( 1, -t,  0).normalize(radius),
-        Point3D( 0, -1,  t).normalize(radius),
-        Point3D( 0,  1,  t).normalize(radius),
-        Point3D( 0, -1, -t).normalize(radius),
-        Point3D( 0,  1, -t).normalize(radius),
-        Point3D( t,  0, -1).normalize(radius),
-        Point3D( t,  0,  1).normalize(radius),
-        Point3D(-t,  0, -1).normalize(radius),
-        Point3D(-t,  0,  1).normalize(radius)
-    };
-    struct TriangleIndex { int v1, v2, v3; };
-    vector<TriangleIndex> faces = {
-        {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
-        {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
-        {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
-        {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}
-    };
-    vector<Point3D> currentVertices = baseVertices;
-    auto getMiddlePoint = [&](int p1, int p2) -> int {
-        Point3D point1 = currentVertices[p1];
-        Point3D point2 = currentVertices[p2];
+struct TriangleIndex { uint32_t v1, v2, v3; };
+
+static const float ICO_T = (1.0f + sqrt(5.0f)) / 2.0f;
+static const float ICO_BASE[12][3] = {
+    {-1,  ICO_T,  0}, { 1,  ICO_T,  0}, {-1, -ICO_T,  0}, { 1, -ICO_T,  0},
+    { 0, -1,  ICO_T}, { 0,  1,  ICO_T}, { 0, -1, -ICO_T}, { 0,  1, -ICO_T},
+    { ICO_T,  0, -1}, { ICO_T,  0,  1}, {-ICO_T,  0, -1}, {-ICO_T,  0,  1}
+};
+static const TriangleIndex ICO_FACES[20] = {
+    {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+    {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+    {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+    {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}
+};
+
+static Point3D icoBasePoint(int i, float radius) {
+    return Point3D(ICO_BASE[i][0], ICO_BASE[i][1], ICO_BASE[i][2]).normalize(radius);
+}
+
+/**
+ * Splits every face into four, `subdivisions` times. Each edge's midpoint
+ * is created once and looked up by the edge's two vertex indices after
+ * that, so the work is linear in the face count. A face's children stay
+ * together and in order, so face k of the input ends up as the k-th run
+ * of 4^subdivisions output faces.
+ */
+static void subdivide(float radius, int subdivisions, vector<Point3D>& points, vector<TriangleIndex>& faces) {
+    // Midpoints of the current level, keyed by (lower index, higher index)
+    unordered_map<uint64_t, uint32_t> midpoints;
+    auto getMiddlePoint = [&](uint32_t p1, uint32_t p2) -> uint32_t {
+        uint64_t key = p1 < p2 ? ((uint64_t)p1 << 32) | p2 : ((uint64_t)p2 << 32) | p1;
+        auto found = midpoints.find(key);
+        if (found != midpoints.end()) return found->second;
+        const Point3D& point1 = points[p1];
+        const Point3D& point2 = points[p2];
         Point3D middle(
             (point1.x + point2.x) / 2.0f,
             (point1.y + point2.y) / 2.0f,
             (point1.z + point2.z) / 2.0f
         );
-        currentVertices.push_back(middle.normalize(radius));
-        return currentVertices.size() - 1;
+        points.push_back(middle.normalize(radius));
+        uint32_t index = points.size() - 1;
+        midpoints.emplace(key, index);
+        return index;
     };
     for(int i = 0; i < subdivisions; i++) {
+        // 3F/2 edges on the closed sphere, plus the open border of one base face
+        size_t edges = faces.size() * 3 / 2 + ((size_t)3 << i);
+        midpoints.clear();
+        midpoints.reserve(edges);
+        points.reserve(points.size() + edges);
         vector<TriangleIndex> nextFaces;
+        nextFaces.reserve(faces.size() * 4);
         for(const auto& face : faces) {
-            int a = getMiddlePoint(face.v1, face.v2);
-            int b = getMiddlePoint(face.v2, face.v3);
-            int c = getMiddlePoint(face.v3, face.v1);
+            uint32_t a = getMiddlePoint(face.v1, face.v2);
+            uint32_t b = getMiddlePoint(face.v2, face.v3);
+            uint32_t c = getMiddlePoint(face.v3, face.v1);
             nextFaces.push_back({face.v1, a, c});
             nextFaces.push_back({face.v2, b, a});
             nextFaces.push_back({face.v3, c, b});
             nextFaces.push_back({a, b, c});
         }
-        faces = nextFaces;
+        faces.swap(nextFaces);
+    }
+}
+
+/**
+ * Builds the whole icosphere with shared vertices: level n has exactly
+ * 10 * 4^n + 2 of them.
+ *
+ * @param coords   Receives the unique vertices as x, y, z floats
+ * @param indices  Receives three indices into coords per triangle
+ */
+void buildIcosphere(float radius, int subdivisions, vector<float>& coords, vector<uint32_t>& indices) {
+    vector<Point3D> points;
+    for (int i = 0; i < 12; i++) points.push_back(icoBasePoint(i, radius));
+    vector<TriangleIndex> faces(ICO_FACES, ICO_FACES + 20);
+    subdivide(radius, subdivisions, points, faces);
+
+    coords.clear();
+    coords.reserve(points.size() * 3);
+    for (const Point3D& p : points) {
+        coords.push_back(p.x);
+        coords.push_back(p.y);
+        coords.push_back(p.z);
     }
-    for(const auto& face : faces) {
-        generateTriangle(vertices,
-            currentVertices[face.v1].x, currentVertices[face.v1].y, currentVertices[face.v1].z,
-            currentVertices[face.v2].x, currentVertices[face.v2].y, currentVertices[face.v2].z,
-            currentVertices[face.v3].x, currentVertices[face.v3].y, currentVertices[face.v3].z);
+    indices.clear();
+    indices.reserve(faces.size() * 3);
+    for (const auto& face : faces) {
+        indices.push_back(face.v1);
+        indices.push_back(face.v2);
+        indices.push_back(face.v3);
     }
 }
+
+// Faces past this many subdivisions are generated as separate work items,
+// so one item is at most 4^6 triangles however fine the sphere is
+static const int ICO_ITEM_SUBDIVISIONS = 6;
+
+/**
+ * Triangle list, one work item at a time. A midpoint depends only on its
+ * edge's end points, so subdividing faces separately gives exactly the
+ * vertices of the whole-mesh subdivision, and the faces can go to
+ * different threads. Fine spheres are first split into 20 * 4^k faces and
+ * each of those is subdivided the rest of the way as its own item; since a
+ * face's children stay together and in order, the output is unchanged.
+ */
+void generateIcosphere(float radius, int subdivisions, VertexSink& vertices) {
+    int split = max(0, subdivisions - ICO_ITEM_SUBDIVISIONS);
+    vector<Point3D> splitPoints;
+    for (int i = 0; i < 12; i++) splitPoints.push_back(icoBasePoint(i, radius));
+    vector<TriangleIndex> splitFaces(ICO_FACES, ICO_FACES + 20);
+    subdivide(radius, split, splitPoints, splitFaces);
+    int remaining = subdivisions - split;
+
+    auto emitFaces = [&](size_t begin, size_t end, VertexSink& out) {
+        for (size_t f = begin; f < end; f++) {
+            const TriangleIndex& item = splitFaces[f];
+            vector<Point3D> points = {
+                splitPoints[item.v1], splitPoints[item.v2], splitPoints[item.v3]
+            };
+            vector<TriangleIndex> faces = { {0, 1, 2} };
+            subdivide(radius, remaining, points, faces);
+            for (const auto& face : faces) {
+                const Point3D& p1 = points[face.v1];
+                const Point3D& p2 = points[face.v2];
+                const Point3D& p3 = points[face.v3];
+                generateTriangle(out, p1.x, p1.y, p1.z, p2.x, p2.y, p2.z, p3.x, p3.y, p3.z);
+            }
+        }
+    };
+    size_t faceVertices = 3 * ((size_t)1 << (2 * remaining));
+    generateInOrder(splitFaces.size(), [&](size_t) { return faceVertices; }, emitFaces, vertices);
+}
@@ -0,0 +1,177 @@
+#include "../include/generator_commands.h"
+#include "../include/generator_stats.h"
+#include "../include/trace.h"
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <map>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+using namespace std;
+
+// ============================================================================
+// MANIFEST — many figures in one run
+// ============================================================================
+
+struct ManifestEntry {
+    int line;
+    FigureCommand command;
+    int producer;            // entry whose output is this scatter's model, or -1
+    vector<int> dependents;  // entries that scatter this one's output
+    int consumersLeft;       // dependents that have not finished yet
+    bool captured;           // mesh holds the output (freed after the last dependent)
+    vector<float> mesh;
+    bool failed;
+    ManifestEntry() : line(0), producer(-1), consumersLeft(0), captured(false), failed(false) {}
+};
+
+/**
+ * Reads and checks every command; nothing is generated if a line is wrong
+ */
+static bool readManifest(const string& file, vector<ManifestEntry>& entries) {
+    ifstream in(file);
+    if (!in.is_open()) {
+        cerr << "Error: Could not open manifest " << file << endl;
+        return false;
+    }
+    bool valid = true;
+    string line;
+    for (int number = 1; getline(in, line); number++) {
+        size_t comment = line.find('#');
+        if (comment != string::npos) line.erase(comment);
+        istringstream words(line);
+        vector<string> args;
+        string word;
+        while (words >> word) args.push_back(word);
+        if (args.empty()) continue;
+
+        bool indexed = args.front() == "--indexed";
+        if (indexed) args.erase(args.begin());
+        ManifestEntry entry;
+        entry.line = number;
+        if (!parseFigureCommand(args, indexed, entry.command)) {
+            cerr << "  at " << file << ":" << number << endl;
+            valid = false;
+            continue;
+        }
+        entries.push_back(entry);
+    }
+    return valid;
+}
+
+/**
+ * Links each scatter to the entry that writes its model; false on a
+ * duplicate output or a cycle
+ */
+static bool linkManifest(const string& file, vector<ManifestEntry>& entries) {
+    map<string, int> producers;
+    for (int i = 0; i < (int)entries.size(); i++) {
+        const string& output = entries[i].command.output;
+        auto inserted = producers.emplace(output, i);
+        if (!inserted.second) {
+            cerr << "Error: " << file << ":" << entries[i].line << " writes " << output
+                 << ", already written at line " << entries[inserted.first->second].line << endl;
+            return false;
+        }
+    }
+    for (int i = 0; i < (int)entries.size(); i++) {
+        const string& model = entries[i].command.model;
+        auto found = model.empty() ? producers.end() : producers.find(model);
+        if (found == producers.end()) continue;  // read from figures/
+        entries[i].producer = found->second;
+        entries[found->second].dependents.push_back(i);
+        entries[found->second].consumersLeft++;
+    }
+    // Every entry has at most one producer, so a cycle is a chain that comes back
+    for (int i = 0; i < (int)entries.size(); i++) {
+        int p = entries[i].producer;
+        for (size_t steps = 0; p >= 0 && steps <= entries.size(); steps++) {
+            if (p == i) {
+                cerr << "Error: " << file << ":" << entries[i].line << " depends on its own output" << endl;
+                return false;
+            }
+            p = entries[p].producer;
+        }
+    }
+    return true;
+}
+
+bool runManifest(const string& file) {
+    TraceScope trace("manifest", "generator", file.c_str());
+    vector<ManifestEntry> entries;
+    if (!readManifest(file, entries) || !linkManifest(file, entries)) return false;
+
+    mutex lock;
+    condition_variable changed;
+    mutex exclusiveLock;
+    deque<int> ready;
+    size_t finished = 0;
+    for (int i = 0; i < (int)entries.size(); i++) {
+        if (entries[i].producer < 0) ready.push_back(i);
+    }
+
+    auto worker = [&]() {
+        unique_lock<mutex> guard(lock);
+        while (true) {
+            changed.wait(guard, [&] { return !ready.empty() || finished == entries.size(); });
+            if (ready.empty()) return;
+            int i = ready.front();
+            ready.pop_front();
+            ManifestEntry& entry = entries[i];
+            const ManifestEntry* producer = entry.producer >= 0 ? &entries[entry.producer] : NULL;
+            bool skip = producer && producer->failed;
+            const vector<float>* model = producer && producer->captured ? &producer->mesh : NULL;
+            // Only dependents read the copy, and they start after this entry is done
+            vector<float>* capture = entry.dependents.empty() || entry.command.write ? NULL : &entry.mesh;
+            guard.unlock();
+
+            bool ok = false;
+            if (skip) {
+                cerr << "Error: " << file << ":" << entry.line << " skipped, its model "
+                     << entry.command.model << " failed" << endl;
+            } else if (entry.command.exclusive) {
+                lock_guard<mutex> alone(exclusiveLock);
+                StatsScope timed(generatorStats.figureMs);
+                ok = runFigureCommand(entry.command, model, NULL);
+            } else {
+                StatsScope timed(generatorStats.figureMs);
+                ok = runFigureCommand(entry.command, model, capture);
+            }
+
+            guard.lock();
+            entry.failed = !ok;
+            entry.captured = ok && capture;
+            finished++;
+            if (entry.producer >= 0 && --entries[entry.producer].consumersLeft == 0) {
+                vector<float>().swap(entries[entry.producer].mesh);
+            }
+            for (int d : entry.dependents) ready.push_back(d);
+            changed.notify_all();
+        }
+    };
+
+    // One figure per thread, each generated serially (a manifest with a
+    // single figure keeps the worker threads for that figure)
+    size_t workers = min((size_t)generatorWorkerCount(), entries.size());
+    if (workers <= 1) {
+        worker();
+    } else {
+        vector<thread> threads;
+        for (size_t w = 0; w < workers; w++) {
+            threads.emplace_back([&]() {
+                generateSeriallyOnThisThread();
+                worker();
+            });
+        }
+        for (thread& t : threads) t.join();
+    }
+
+    size_t failed = count_if(entries.begin(), entries.end(), [](const ManifestEntry& e) { return e.failed; });
+    cout << "Manifest " << file << ": " << entries.size() - failed << " of " << entries.size()
+         << " figures generated" << endl;
+    return failed == 0;
+}
@@ -1,10 +1,9 @@
-#include <list>
 #include <string>
 #include "../include/generator_helpers.h"
 
 using namespace std;
 
-void generateOctahedron(list<string>& vertices, float x, float y, float z, float scale) {
+void generateOctahedron(VertexSink& vertices, float x, float y, float z, float scale) {
     float v[6][3] = {
         {1*scale + x, 0*scale + y, 0*scale + z},
         {-1*scale + x, 0*scale + y, 0*scale + z},
@@ -0,0 +1,34 @@
+#include "../include/parametric.h"
+#include <cmath>
+
+using namespace std;
+
+TrigTable::TrigTable(int count, float step) : cosv(count + 1), sinv(count + 1) {
+    for (int k = 0; k <= count; k++) {
+        float angle = k * step;
+        cosv[k] = cos(angle);
+        sinv[k] = sin(angle);
+    }
+}
+
+void sweepGrid(int rows, int cols,
+               const function<void(int, GridRow&)>& evalRow,
+               const function<size_t(int)>& bandVertices,
+               const function<void(int, const GridRow&, const GridRow&, VertexSink&)>& emitBand,
+               VertexSink& vertices) {
+    auto emitBands = [&](size_t begin, size_t end, VertexSink& out) {
+        GridRow low, high;
+        for (GridRow* row : { &low, &high }) {
+            row->x.resize(cols + 1);
+            row->y.resize(cols + 1);
+            row->z.resize(cols + 1);
+        }
+        evalRow((int)begin, low);
+        for (int r = (int)begin; r < (int)end; r++) {
+            evalRow(r + 1, high);
+            emitBand(r, low, high, out);
+            swap(low, high);
+        }
+    };
+    generateInOrder(rows, [&](size_t r) { return bandVertices((int)r); }, emitBands, vertices);
+}
@@ -1,4 +1,3 @@
-#include <list>
 #include <string>
 #include <cmath>
 #include "../include/generator_helpers.h"
@@ -6,27 +5,31 @@
 using namespace std;
 
 
-void generatePlane(float length, int divisions, list<string>& vertices) {
+void generatePlane(float length, int divisions, VertexSink& vertices) {
     float half = length / 2.0f;
     float step = length / divisions;
-    for (int i = 0; i < divisions; i++) {
-        for (int j = 0; j < divisions; j++) {
-            float x0 = -half + i * step;
-            float x1 = -half + (i + 1) * step;
-            float z0 = -half + j * step;
-            float z1 = -half + (j + 1) * step;
-            // Top face
-            generateQuad(vertices,
-                x0, 0.0f, z0,
-                x1, 0.0f, z0,
-                x0, 0.0f, z1,
-                x1, 0.0f, z1);
-            // Bottom face
-            generateQuad(vertices,
-                x1, 0.0f, z0,
-                x0, 0.0f, z0,
-                x1, 0.0f, z1,
-                x0, 0.0f, z1);
+    // Rows of cells (i) are independent and can be generated in parallel
+    auto emitRows = [&](size_t begin, size_t end, VertexSink& out) {
+        for (int i = (int)begin; i < (int)end; i++) {
+            for (int j = 0; j < divisions; j++) {
+                float x0 = -half + i * step;
+                float x1 = -half + (i + 1) * step;
+                float z0 = -half + j * step;
+                float z1 = -half + (j + 1) * step;
+                // Top face
+                generateQuad(out,
+                    x0, 0.0f, z0,
+                    x1, 0.0f, z0,
+                    x0, 0.0f, z1,
+                    x1, 0.0f, z1);
+                // Bottom face
+                generateQuad(out,
+                    x1, 0.0f, z0,
+                    x0, 0.0f, z0,
+                    x1, 0.0f, z1,
+                    x0, 0.0f, z1);
+            }
         }
-    }
+    };
+    generateInOrder(divisions, [&](size_t) { return 12 * (size_t)divisions; }, emitRows, vertices);
 }
@@ -1,7 +1,7 @@
-#include <list>
 #include <string>
 #include <cmath>
 #include "../include/generator_helpers.h"
+#include "../include/parametric.h"
 
 using namespace std;
 
@@ -12,7 +12,7 @@ using namespace std;
  * @param innerRadius  Inner radius of the ring
  * @param outerRadius  Outer radius of the ring
  * @param slices       Number of angular divisions around the ring
- * @param vertices     Output vertex list
+ * @param vertices     Receives the triangle-list vertices
  *
  * Creates two triangle fans (top and bottom faces) to keep backface culling happy.
  * Each slice is a quad between innerRadius and outerRadius at angle [a, a+step].
@@ -23,31 +23,41 @@ using namespace std;
  *    p1 ------- p3
  *   inner       inner
  */
-void generateRing(float innerRadius, float outerRadius, int slices, list<string>& vertices) {
-    float step = 2.0f * M_PI / slices;
+void generateRing(float innerRadius, float outerRadius, int slices, VertexSink& vertices) {
+    TrigTable angle(slices, 2.0f * M_PI / slices);
 
-    for (int i = 0; i < slices; i++) {
-        float a1 = i * step;
-        float a2 = (i + 1) * step;
+    // Row 0 is the inner circle, row 1 the outer one
+    auto evalRow = [&](int r, GridRow& row) {
+        float radius = r == 0 ? innerRadius : outerRadius;
+        for (int i = 0; i <= slices; i++) {
+            row.x[i] = radius * angle.cosv[i];
+            row.y[i] = 0.0f;
+            row.z[i] = radius * angle.sinv[i];
+        }
+    };
+    auto emitBand = [&](int, const GridRow& inner, const GridRow& outer, VertexSink& out) {
+        for (int i = 0; i < slices; i++) {
+            float ix1 = inner.x[i],     iz1 = inner.z[i];
+            float ox1 = outer.x[i],     oz1 = outer.z[i];
+            float ix2 = inner.x[i + 1], iz2 = inner.z[i + 1];
+            float ox2 = outer.x[i + 1], oz2 = outer.z[i + 1];
 
-        float ix1 = innerRadius * cos(a1), iz1 = innerRadius * sin(a1);
-        float ox1 = outerRadius * cos(a1), oz1 = outerRadius * sin(a1);
-        float ix2 = innerRadius * cos(a2), iz2 = innerRadius * sin(a2);
-        float ox2 = outerRadius * cos(a2), oz2 = outerRadius * sin(a2);
+            // p1=inner a1, p2=outer a1, p3=inner a2, p4=outer a2  (all at y=0)
+            // Top face (normal +Y): CCW from above = p1, p2, p4, p1, p4, p3
+            generateQuad(out,
+                ix1, 0.0f, iz1,   // p1 inner a1
+                ox1, 0.0f, oz1,   // p2 outer a1
+                ix2, 0.0f, iz2,   // p3 inner a2
+                ox2, 0.0f, oz2);  // p4 outer a2
 
-        // p1=inner a1, p2=outer a1, p3=inner a2, p4=outer a2  (all at y=0)
-        // Top face (normal +Y): CCW from above = p1, p2, p4, p1, p4, p3
-        generateQuad(vertices,
-            ix1, 0.0f, iz1,   // p1 inner a1
-            ox1, 0.0f, oz1,   // p2 outer a1
-            ix2, 0.0f, iz2,   // p3 inner a2
-            ox2, 0.0f, oz2);  // p4 outer a2
-
-        // Bottom face (normal -Y): reverse winding
-        generateQuad(vertices,
-            ox1, 0.0f, oz1,   // p2
-            ix1, 0.0f, iz1,   // p1
-            ox2, 0.0f, oz2,   // p4
-            ix2, 0.0f, iz2);  // p3
-    }
+            // Bottom face (normal -Y): reverse winding
+            generateQuad(out,
+                ox1, 0.0f, oz1,   // p2
+                ix1, 0.0f, iz1,   // p1
+                ox2, 0.0f, oz2,   // p4
+                ix2, 0.0f, iz2);  // p3
+        }
+    };
+    auto bandVertices = [&](int) { return 12 * (size_t)slices; };
+    sweepGrid(1, slices, evalRow, bandVertices, emitBand, vertices);
 }
@@ -1,49 +1,121 @@
 #include "../include/figures.h"
-#include <list>
+#include "../include/generator_stats.h"
+#include "../include/trace.h"
 #include <vector>
 #include <string>
 #include <iostream>
-#include <sstream>
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 
 using namespace std;
 
-struct ScatterSample { float x, y, z; };
+// ============================================================================
+// SCATTER — meta-generator
+// ============================================================================
+
+static const uint64_t SCATTER_SEED = 42;
+static const size_t SCATTER_BLOCK_FLOATS = 1 << 21;  // transformed vertices held at once (8 MB)
+
+enum ScatterShape { SCATTER_SPHERE, SCATTER_TORUS, SCATTER_PLANE, SCATTER_CYLINDER, SCATTER_BOX };
+
+static bool parseScatterShape(const string& shape, ScatterShape& out) {
+    if      (shape == "sphere")   out = SCATTER_SPHERE;
+    else if (shape == "torus")    out = SCATTER_TORUS;
+    else if (shape == "plane")    out = SCATTER_PLANE;
+    else if (shape == "cylinder") out = SCATTER_CYLINDER;
+    else if (shape == "box")      out = SCATTER_BOX;
+    else {
+        cerr << "scatter: unknown volume shape '" << shape << "'" << endl;
+        cerr << "Supported: sphere, torus, plane, cylinder, box" << endl;
+        return false;
+    }
+    return true;
+}
 
-inline float rand01() { return (float)rand() / RAND_MAX; }
+/**
+ * Counter-based random numbers: draw k of instance i is a hash of
+ * (seed, i, k), so an instance gets the same numbers whichever thread
+ * computes it and in whatever order (SplitMix64 finalizer)
+ */
+struct InstanceRng {
+    uint64_t key;
+    uint64_t draw;
+    InstanceRng(uint64_t seed, uint64_t instance)
+        : key(mix(seed ^ mix(instance + 0x9E3779B97F4A7C15ull))), draw(0) {}
 
-bool sampleVolume(const string& shape, const vector<float>& p, ScatterSample& out) {
-    if (shape == "sphere") {
-        float r = p[0] + rand01() * (p[1] - p[0]);
-        float u = rand01(), v = rand01();
+    static uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    /**
+     * Uniform in [0, 1), 24 bits
+     */
+    float next01() {
+        return (mix(key + ++draw * 0x9E3779B97F4A7C15ull) >> 40) * (1.0f / 16777216.0f);
+    }
+};
+
+struct ScatterSample { float x, y, z; };
+
+/**
+ * Samples a random point inside a volume shell defined by shape + inner/outer params.
+ *
+ * Supported shapes:
+ *   sphere  <r_min> <r_max>             — spherical shell
+ *   torus   <R> <r_min> <r_max>         — toroidal shell  (flat: y is thin)
+ *   plane   <width> <height>            — flat XZ plane
+ *   cylinder <r_min> <r_max> <h_min> <h_max>  — cylindrical shell
+ *   box     <inner_half> <outer_half>   — cubic shell (surface of hollow box)
+ */
+static ScatterSample sampleVolume(ScatterShape shape, const vector<float>& p, InstanceRng& rng) {
+    ScatterSample out = { 0.0f, 0.0f, 0.0f };
+    switch (shape) {
+    case SCATTER_SPHERE: {
+        // p: r_min r_max
+        float r = p[0] + rng.next01() * (p[1] - p[0]);
+        float u = rng.next01(), v = rng.next01();
         float theta = 2.0f * M_PI * u;
         float phi   = acos(2.0f * v - 1.0f);
         out = { r * sin(phi) * cos(theta),
                 r * sin(phi) * sin(theta),
                 r * cos(phi) };
-    } else if (shape == "torus") {
+        break;
+    }
+    case SCATTER_TORUS: {
+        // p: R r_min r_max
         float R = p[0];
-        float r = p[1] + rand01() * (p[2] - p[1]);
-        float u = rand01() * 2.0f * M_PI;
-        float v = rand01() * 2.0f * M_PI;
+        float r = p[1] + rng.next01() * (p[2] - p[1]);
+        float u = rng.next01() * 2.0f * M_PI;
+        float v = rng.next01() * 2.0f * M_PI;
         out = { (R + r * cos(v)) * cos(u),
                 (R + r * cos(v)) * sin(u),
                  r * sin(v) };
-    } else if (shape == "plane") {
-        out = { (rand01() - 0.5f) * p[0],
-                0.0f,
-                (rand01() - 0.5f) * p[1] };
-    } else if (shape == "cylinder") {
-        float r = p[0] + rand01() * (p[1] - p[0]);
-        float h = p[2] + rand01() * (p[3] - p[2]);
-        float angle = rand01() * 2.0f * M_PI;
+        break;
+    }
+    case SCATTER_PLANE:
+        // p: width height
+        out.x = (rng.next01() - 0.5f) * p[0];
+        out.z = (rng.next01() - 0.5f) * p[1];
+        break;
+    case SCATTER_CYLINDER: {
+        // p: r_min r_max h_min h_max
+        float r = p[0] + rng.next01() * (p[1] - p[0]);
+        float h = p[2] + rng.next01() * (p[3] - p[2]);
+        float angle = rng.next01() * 2.0f * M_PI;
         out = { r * cos(angle), h, r * sin(angle) };
-    } else if (shape == "box") {
+        break;
+    }
+    case SCATTER_BOX: {
+        // p: inner_half outer_half
+        // Pick a random point in the shell of the box by choosing a face
+        // and a random position on that face, with depth between inner and outer.
         float inner = p[0], outer = p[1];
-        int face = rand() % 6;
-        float depth = inner + rand01() * (outer - inner);
-        float u = (rand01() - 0.5f) * 2.0f * outer;
-        float v = (rand01() - 0.5f) * 2.0f * outer;
+        int face = min(5, (int)(rng.next01() * 6.0f));
+        float depth = inner + rng.next01() * (outer - inner);
+        float u = (rng.next01() - 0.5f) * 2.0f * outer;
+        float v = (rng.next01() - 0.5f) * 2.0f * outer;
         switch (face) {
             case 0: out = {  depth, u, v }; break;
             case 1: out = { -depth, u, v }; break;
@@ -52,60 +124,136 @@ bool sampleVolume(const string& shape, const vector<float>& p, ScatterSample& ou
             case 4: out = { u, v,  depth }; break;
             case 5: out = { u, v, -depth }; break;
         }
-    } else {
-        cerr << "scatter: unknown volume shape '" << shape << "'" << endl;
-        cerr << "Supported: sphere, torus, plane, cylinder, box" << endl;
-        return false;
+        break;
     }
-    return true;
+    }
+    return out;
 }
 
-string transformVertex(const string& vertexLine,
-                       float tx, float ty, float tz,
-                       float rx, float ry, float rz,
-                       float scale) {
-    float x, y, z;
-    istringstream ss(vertexLine);
-    ss >> x >> y >> z;
+/**
+ * The model as separate x, y, z arrays, so the per-vertex transform is
+ * a straight loop the compiler vectorizes
+ */
+struct ScatterModel {
+    vector<float> x, y, z;
+    size_t size() const { return x.size(); }
+};
 
-    x *= scale; y *= scale; z *= scale;
+/**
+ * One copy of the model: scale, rotateX, rotateY, rotateZ folded into a
+ * row-major 3x3 matrix, then translate
+ */
+struct ScatterInstance {
+    float m[9];
+    float tx, ty, tz;
+};
 
-    float y2 =  y * cos(rx) - z * sin(rx);
-    float z2 =  y * sin(rx) + z * cos(rx);
-    y = y2; z = z2;
+static void multiply3(const float a[9], const float b[9], float out[9]) {
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            out[r * 3 + c] = a[r * 3] * b[c] + a[r * 3 + 1] * b[3 + c] + a[r * 3 + 2] * b[6 + c];
+}
 
-    float x2 =  x * cos(ry) + z * sin(ry);
-    float z3 = -x * sin(ry) + z * cos(ry);
-    x = x2; z = z3;
+/**
+ * Position, scale and rotation of instance i (depends on nothing but i and the seed)
+ */
+static ScatterInstance makeInstance(ScatterShape shape, const vector<float>& params,
+                                    float scaleMin, float scaleMax, uint64_t i) {
+    InstanceRng rng(SCATTER_SEED, i);
+    ScatterSample pos = sampleVolume(shape, params, rng);
+    float scale = scaleMin + rng.next01() * (scaleMax - scaleMin);
+    float rx    = rng.next01() * 2.0f * M_PI;
+    float ry    = rng.next01() * 2.0f * M_PI;
+    float rz    = rng.next01() * 2.0f * M_PI;
 
-    float x3 =  x * cos(rz) - y * sin(rz);
-    float y3 =  x * sin(rz) + y * cos(rz);
-    x = x3; y = y3;
+    float cx = cos(rx), sx = sin(rx);
+    float cy = cos(ry), sy = sin(ry);
+    float cz = cos(rz), sz = sin(rz);
+    const float rotX[9] = { 1, 0, 0,   0, cx, -sx,   0, sx, cx };
+    const float rotY[9] = { cy, 0, sy,   0, 1, 0,   -sy, 0, cy };
+    const float rotZ[9] = { cz, -sz, 0,   sz, cz, 0,   0, 0, 1 };
+    float zy[9];
+    multiply3(rotZ, rotY, zy);
 
-    x += tx; y += ty; z += tz;
+    ScatterInstance inst;
+    multiply3(zy, rotX, inst.m);
+    for (float& v : inst.m) v *= scale;
+    inst.tx = pos.x; inst.ty = pos.y; inst.tz = pos.z;
+    return inst;
+}
 
-    ostringstream out;
-    out << x << " " << y << " " << z;
-    return out.str();
+/**
+ * Writes the transformed model as x, y, z triples at out
+ */
+static void transformModel(const ScatterModel& model, const ScatterInstance& inst, float* out) {
+    const float* xs = model.x.data();
+    const float* ys = model.y.data();
+    const float* zs = model.z.data();
+    const float* m = inst.m;
+    const size_t n = model.size();
+    for (size_t k = 0; k < n; k++) {
+        float x = xs[k], y = ys[k], z = zs[k];
+        out[3 * k]     = m[0] * x + m[1] * y + m[2] * z + inst.tx;
+        out[3 * k + 1] = m[3] * x + m[4] * y + m[5] * z + inst.ty;
+        out[3 * k + 2] = m[6] * x + m[7] * y + m[8] * z + inst.tz;
+    }
 }
 
-void generateScatter(const string& shape, const vector<float>& params, int num,
-                     const vector<string>& modelVerts, float scaleMin, float scaleMax,
-                     list<string>& vertices) {
-    srand(42);
-    for (int i = 0; i < num; i++) {
-        ScatterSample pos;
-        if (!sampleVolume(shape, params, pos)) return;
-
-        float scale = scaleMin + rand01() * (scaleMax - scaleMin);
-        float rx    = rand01() * 2.0f * M_PI;
-        float ry    = rand01() * 2.0f * M_PI;
-        float rz    = rand01() * 2.0f * M_PI;
-
-        for (const string& v : modelVerts) {
-            vertices.push_back(
-                transformVertex(v, pos.x, pos.y, pos.z, rx, ry, rz, scale)
-            );
+/**
+ * Places `num` copies of a figure at random points of a volume shell, each
+ * with a random scale in [scaleMin, scaleMax] and a random rotation.
+ * Instances are built in blocks across the worker threads and handed to
+ * the sink in order; the output is the same for any thread count.
+ */
+bool generateScatter(const string& shape, const vector<float>& params,
+                     const string& modelFile, float scaleMin, float scaleMax,
+                     int num, VertexSink& vertices) {
+    // Parsed once; every instance transforms the same floats
+    vector<float> coords;
+    if (!readFigure(modelFile, coords)) return false;
+    if (coords.empty()) {
+        cerr << "Error: model file " << modelFile << " has no vertices" << endl;
+        return false;
+    }
+    return generateScatter(shape, params, coords, scaleMin, scaleMax, num, vertices);
+}
+
+bool generateScatter(const string& shape, const vector<float>& params,
+                     const vector<float>& coords, float scaleMin, float scaleMax,
+                     int num, VertexSink& vertices) {
+    ScatterShape volume;
+    if (!parseScatterShape(shape, volume)) return false;
+    if (coords.empty()) {
+        cerr << "Error: scatter model has no vertices" << endl;
+        return false;
+    }
+
+    ScatterModel model;
+    model.x.reserve(coords.size() / 3);
+    model.y.reserve(coords.size() / 3);
+    model.z.reserve(coords.size() / 3);
+    for (size_t v = 0; v + 2 < coords.size(); v += 3) {
+        model.x.push_back(coords[v]);
+        model.y.push_back(coords[v + 1]);
+        model.z.push_back(coords[v + 2]);
+    }
+
+    const size_t modelFloats = model.size() * 3;
+    const size_t blockInstances = max((size_t)1, SCATTER_BLOCK_FLOATS / modelFloats);
+    vector<float> block(min(blockInstances, (size_t)max(num, 0)) * modelFloats);
+
+    for (size_t first = 0; first < (size_t)max(num, 0); first += blockInstances) {
+        size_t count = min(blockInstances, (size_t)num - first);
+        {
+            TraceScope trace("scatterBlock", "generator");
+            parallelFor(count, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    ScatterInstance inst = makeInstance(volume, params, scaleMin, scaleMax, first + i);
+                    transformModel(model, inst, &block[i * modelFloats]);
+                }
+            });
         }
+        vertices.vertexBlock(block.data(), count * model.size());
     }
-}
\ No newline at end of file
+    return true;
+}
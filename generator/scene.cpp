@@ -0,0 +1,159 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include "../include/generator_helpers.h"
+#include "../include/figures.h"
+#include "../include/generator_stats.h"
+
+using namespace std;
+
+// ============================================================================
+// SYNTHETIC SCENES
+// ============================================================================
+
+struct SceneNode {
+    int depth;
+    int model;              // index of the figure it draws
+    bool animated;          // gets a physics <body>
+    vector<int> children;
+};
+
+static float sceneRand01() { return (float)rand() / RAND_MAX; }
+
+/**
+ * Writes one of the existing primitives, tessellated by `detail`
+ * (figure i cycles sphere, cylinder, cone, torus; sizes differ slightly so
+ * every file is a distinct mesh); returns the file name, or "" if it
+ * couldn't be written
+ */
+static string writeSceneFigure(const string& base, int index, int detail) {
+    static const char* kinds[] = { "sphere", "cylinder", "cone", "torus" };
+    const char* kind = kinds[index % 4];
+    float size = 1.0f + 0.01f * index;
+    int stacks = detail / 2 > 1 ? detail / 2 : 1;
+
+    string file = base + "_" + kind + "_" + to_string(index) + ".3d";
+    FigureWriter vertices;
+    if (!vertices.open(file)) return "";
+    if (index % 4 == 0)      generateSphere(size, detail, stacks, vertices);
+    else if (index % 4 == 1) generateCylinder(size, 2.0f * size, detail, stacks, vertices);
+    else if (index % 4 == 2) generateCone(size, 2.0f * size, detail, stacks, vertices);
+    else                     generateTorus(size, 0.3f * size, detail, stacks, vertices);
+    if (!vertices.close()) return "";
+    return file;
+}
+
+static void writeSceneGroup(ofstream& out, const vector<SceneNode>& nodes, int index,
+                            const vector<string>& figures, float spread) {
+    const SceneNode& node = nodes[index];
+    string indent((node.depth + 1) * 4, ' ');
+    // Children sit closer to their parent the deeper they are
+    float extent = spread / (1 << min(node.depth, 10));
+
+    out << indent << "<group>\n";
+    out << indent << "    <transform>\n";
+    out << indent << "        <translate x=\"" << (sceneRand01() - 0.5f) * extent
+        << "\" y=\"" << (sceneRand01() - 0.5f) * extent * 0.2f
+        << "\" z=\"" << (sceneRand01() - 0.5f) * extent << "\" />\n";
+    out << indent << "        <rotate angle=\"" << sceneRand01() * 360.0f << "\" x=\"0\" y=\"1\" z=\"0\" />\n";
+    float scale = 0.5f + sceneRand01();
+    out << indent << "        <scale x=\"" << scale << "\" y=\"" << scale << "\" z=\"" << scale << "\" />\n";
+    out << indent << "    </transform>\n";
+    out << indent << "    <models>\n";
+    out << indent << "        <model file=\"" << figures[node.model] << "\" color=\"#"
+        << hex << (0x404040 + (node.model * 0x2F1B07) % 0xBFBFBF) << dec << "\" />\n";
+    out << indent << "    </models>\n";
+    if (node.animated) {
+        out << indent << "    <body mass=\"" << 1.0f + sceneRand01() * 10.0f
+            << "\" vx=\"" << (sceneRand01() - 0.5f) * 2.0f
+            << "\" vy=\"0\" vz=\"" << (sceneRand01() - 0.5f) * 2.0f << "\" />\n";
+    }
+    for (int child : node.children) {
+        writeSceneGroup(out, nodes, child, figures, spread);
+    }
+    out << indent << "</group>\n";
+}
+
+/**
+ * scene <groups> <depth> <fanout> <models> <detail> <animated> <output.xml>
+ *
+ * Groups are placed breadth-first: each new group becomes a child of the
+ * oldest group with room for another child (fewer than `fanout` children
+ * and above `depth`), or a new top-level group when none has room. Group i
+ * draws figure i % models, so groups/models groups share each mesh.
+ */
+bool generateScene(int groups, int depth, int fanout, int models, int detail,
+                   float animated, const string& file) {
+    srand(42);
+    string base = file.substr(0, file.rfind('.'));
+
+    vector<string> figures;
+    for (int i = 0; i < models; i++) {
+        figures.push_back(writeSceneFigure(base, i, detail));
+        if (figures.back().empty()) return false;
+    }
+
+    vector<SceneNode> nodes;
+    vector<int> roots;
+    size_t open = 0;  // oldest node that may still get children
+    int animatedCount = 0;
+    for (int i = 0; i < groups; i++) {
+        while (open < nodes.size() &&
+               (nodes[open].depth + 1 >= depth || (int)nodes[open].children.size() >= fanout)) {
+            open++;
+        }
+        SceneNode node;
+        node.model = i % models;
+        // Spread animated nodes evenly instead of drawing them at random
+        node.animated = (int)((i + 1) * animated) > animatedCount;
+        if (node.animated) animatedCount++;
+        if (open < nodes.size()) {
+            node.depth = nodes[open].depth + 1;
+            nodes[open].children.push_back(i);
+        } else {
+            node.depth = 0;
+            roots.push_back(i);
+        }
+        nodes.push_back(node);
+    }
+
+    StatsScope timing(generatorStats.ioMs);  // the config, formatting included
+    string outputPath = "../../configs/" + file;
+    ofstream out(outputPath);
+    if (!out.is_open()) {
+        cerr << "Error: Could not open file " << outputPath << endl;
+        return false;
+    }
+
+    // Top-level groups spread over a square that grows with their count
+    float spread = 20.0f * sqrt((float)roots.size());
+    out << "<world>\n";
+    out << "    <!-- generator scene " << groups << " " << depth << " " << fanout << " "
+        << models << " " << detail << " " << animated << " -->\n";
+    out << "    <window width=\"1280\" height=\"720\" />\n";
+    out << "    <camera>\n";
+    out << "        <position x=\"0\" y=\"" << spread * 0.6f << "\" z=\"" << spread * 1.2f << "\" />\n";
+    out << "        <lookAt x=\"0\" y=\"0\" z=\"0\" />\n";
+    out << "        <up x=\"0\" y=\"1\" z=\"0\" />\n";
+    out << "        <projection fov=\"60\" near=\"1\" far=\"" << spread * 4.0f << "\" />\n";
+    out << "    </camera>\n";
+    if (animatedCount > 0) {
+        out << "    <physics />\n";
+    }
+    for (int root : roots) {
+        writeSceneGroup(out, nodes, root, figures, spread);
+    }
+    out << "</world>\n";
+    out.close();
+
+    lock_guard<mutex> guard(generatorReportLock);
+    cout << "Scene generated successfully: " << outputPath << endl;
+    cout << "Total: " << groups << " groups (" << roots.size() << " top-level, depth "
+         << depth << ", fan-out " << fanout << "), " << models << " figures, "
+         << animatedCount << " animated" << endl;
+    return true;
+}
@@ -1,40 +1,32 @@
-#include <list>
 #include <string>
 #include <cmath>
 #include "../include/generator_helpers.h"
+#include "../include/parametric.h"
 
 using namespace std;
 
-struct Point3D {
-    float x, y, z;
-    Point3D(float x=0, float y=0, float z=0) : x(x), y(y), z(z) {}
-};
+void generateTorus(float ringRadius, float pipeRadius, int slices, int stacks, VertexSink& vertices) {
+    TrigTable u(slices, 2.0f * M_PI / slices);
+    TrigTable v(stacks, 2.0f * M_PI / stacks);
 
-void generateTorus(float ringRadius, float pipeRadius, int slices, int stacks, list<string>& vertices) {
-    float sliceStep = 2.0f * M_PI / slices;
-    float stackStep = 2.0f * M_PI / stacks;
-    for (int i = 0; i < slices; i++) {
-        float u1 = i * sliceStep;
-        float u2 = (i + 1) * sliceStep;
+    // Row i is the pipe's cross-section at u = i * sliceStep
+    auto evalRow = [&](int i, GridRow& row) {
+        for (int j = 0; j <= stacks; j++) {
+            float horizontalDist = ringRadius + pipeRadius * v.cosv[j];
+            row.x[j] = horizontalDist * u.cosv[i];
+            row.y[j] = pipeRadius * v.sinv[j];
+            row.z[j] = horizontalDist * u.sinv[i];
+        }
+    };
+    auto emitBand = [&](int, const GridRow& r1, const GridRow& r2, VertexSink& out) {
         for (int j = 0; j < stacks; j++) {
-            float v1 = j * stackStep;
-            float v2 = (j + 1) * stackStep;
-            auto getPoint = [&](float u, float v) {
-                float horizontalDist = ringRadius + pipeRadius * cos(v);
-                float x = horizontalDist * cos(u);
-                float y = pipeRadius * sin(v);
-                float z = horizontalDist * sin(u);
-                return Point3D(x, y, z);
-            };
-            Point3D p1 = getPoint(u1, v1);
-            Point3D p2 = getPoint(u2, v1);
-            Point3D p3 = getPoint(u1, v2);
-            Point3D p4 = getPoint(u2, v2);
-            generateQuad(vertices,
-                p1.x, p1.y, p1.z,
-                p2.x, p2.y, p2.z,
-                p3.x, p3.y, p3.z,
-                p4.x, p4.y, p4.z);
+            generateQuad(out,
+                r1.x[j],     r1.y[j],     r1.z[j],
+                r2.x[j],     r2.y[j],     r2.z[j],
+                r1.x[j + 1], r1.y[j + 1], r1.z[j + 1],
+                r2.x[j + 1], r2.y[j + 1], r2.z[j + 1]);
         }
-    }
+    };
+    auto bandVertices = [&](int) { return 6 * (size_t)stacks; };
+    sweepGrid(slices, stacks, evalRow, bandVertices, emitBand, vertices);
 }
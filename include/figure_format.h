@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// ============================================================================
+// .3d FIGURE FILES
+// ============================================================================
+
+// Shared by the generator (writes) and the engine (reads). A figure is a
+// triangle list in one of three layouts:
+//   text    first line: vertex count; then one "x y z" line per vertex
+//   binary  FigureBinaryHeader, then vertexCount x/y/z float triples in
+//           native (little-endian) byte order, read straight into memory
+//   indexed FigureBinaryHeader with the indexed magic (vertexCount unique
+//           vertices), a uint64 index count, the vertices, then uint32
+//           indices, three per triangle (generator --indexed)
+
+struct FigureBinaryHeader {
+    char magic[4];          // "3DB1"
+    uint32_t reserved;      // 0
+    uint64_t vertexCount;
+};
+
+static const char FIGURE_BINARY_MAGIC[4] = { '3', 'D', 'B', '1' };
+static const char FIGURE_INDEXED_MAGIC[4] = { '3', 'D', 'I', '1' };
+
+inline bool isBinaryFigureHeader(const FigureBinaryHeader& header) {
+    return memcmp(header.magic, FIGURE_BINARY_MAGIC, sizeof(header.magic)) == 0;
+}
+
+inline bool isIndexedFigureHeader(const FigureBinaryHeader& header) {
+    return memcmp(header.magic, FIGURE_INDEXED_MAGIC, sizeof(header.magic)) == 0;
+}
+
+/**
+ * Whether a file of fileBytes is long enough for the counts in its header
+ * (indexCount: indexed figures only). Checked before allocating, so a
+ * corrupt count is rejected instead of turned into a huge allocation.
+ */
+inline bool figureFitsFile(const FigureBinaryHeader& header, uint64_t indexCount, uint64_t fileBytes) {
+    bool indexed = isIndexedFigureHeader(header);
+    uint64_t fixed = sizeof(header) + (indexed ? sizeof(uint64_t) : 0);
+    if (fileBytes < fixed) return false;
+    uint64_t left = fileBytes - fixed;
+    const uint64_t vertexBytes = 3 * sizeof(float);
+    if (header.vertexCount > left / vertexBytes) return false;
+    left -= header.vertexCount * vertexBytes;
+    return !indexed || indexCount <= left / sizeof(uint32_t);
+}
@@ -1,18 +1,26 @@
 #pragma once
-#include <list>
 #include <string>
-#include <vector> // Added to fix missing vector type
+#include <vector>
+#include <cstdint>
+#include "generator_helpers.h"
 using namespace std;
 
-void generateBox(float length, int divisions, list<string>& vertices);
-void generatePlane(float length, int divisions, list<string>& vertices);
-void generateSphere(float radius, int slices, int stacks, list<string>& vertices);
-void generateCone(float radius, float height, int slices, int stacks, list<string>& vertices);
-void generateCylinder(float radius, float height, int slices, int stacks, list<string>& vertices);
-void generateIcosphere(float radius, int subdivisions, list<string>& vertices);
-void generateTorus(float ringRadius, float pipeRadius, int slices, int stacks, list<string>& vertices);
-void generateRing(float innerRadius, float outerRadius, int slices, list<string>& vertices);
-void generateOctahedron(list<string>& vertices, float x, float y, float z, float scale);
-void generateScatter(const string& shape, const vector<float>& params,
+void generateBox(float length, int divisions, VertexSink& vertices);
+void generatePlane(float length, int divisions, VertexSink& vertices);
+void generateSphere(float radius, int slices, int stacks, VertexSink& vertices);
+void generateCone(float radius, float height, int slices, int stacks, VertexSink& vertices);
+void generateCylinder(float radius, float height, int slices, int stacks, VertexSink& vertices);
+void generateIcosphere(float radius, int subdivisions, VertexSink& vertices);
+void buildIcosphere(float radius, int subdivisions, vector<float>& coords, vector<uint32_t>& indices);
+void generateTorus(float ringRadius, float pipeRadius, int slices, int stacks, VertexSink& vertices);
+void generateRing(float innerRadius, float outerRadius, int slices, VertexSink& vertices);
+void generateOctahedron(VertexSink& vertices, float x, float y, float z, float scale);
+bool generateScene(int groups, int depth, int fanout, int models, int detail,
+                   float animated, const string& file);
+bool generateScatter(const string& shape, const vector<float>& params,
                      const string& modelFile, float scaleMin, float scaleMax,
-                     int num, list<string>& vertices);
+                     int num, VertexSink& vertices);
+// Same, from a model already in memory (x, y, z triples)
+bool generateScatter(const string& shape, const vector<float>& params,
+                     const vector<float>& coords, float scaleMin, float scaleMax,
+                     int num, VertexSink& vertices);
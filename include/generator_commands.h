@@ -0,0 +1,54 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include "generator_helpers.h"
+using namespace std;
+
+// ============================================================================
+// GENERATOR COMMANDS
+// ============================================================================
+
+/**
+ * One figure to generate, from the command line or a manifest line
+ * (`<shape> <parameters...> <output_file>`)
+ */
+struct FigureCommand {
+    string shape;
+    string output;
+    string model;     // figure that scatter copies ("" for other shapes)
+    bool exclusive;   // uses process-wide state (scene draws from rand()): runs alone
+    /**
+     * Generate into the sink; model is scatter's source mesh when it is
+     * already in memory, NULL to read `model` from figures/
+     */
+    function<bool(VertexSink&, const vector<float>*)> generate;
+    /**
+     * Set instead of generate by commands that write their own files
+     * (scene, indexed icosphere)
+     */
+    function<bool()> write;
+    FigureCommand() : exclusive(false) {}
+};
+
+void printGeneratorUsage(const char* program);
+
+/**
+ * Parse `<shape> <parameters...> <output_file>`; prints what is wrong
+ * and returns false for an invalid command
+ */
+bool parseFigureCommand(const vector<string>& args, bool indexed, FigureCommand& command);
+
+/**
+ * Generate and write a parsed command; with capture, the vertices are
+ * kept there too (x, y, z triples)
+ */
+bool runFigureCommand(const FigureCommand& command, const vector<float>* model, vector<float>* capture);
+
+/**
+ * Generate every figure listed in a manifest, one command per line ('#'
+ * starts a comment, a line may start with --indexed). Figures run
+ * concurrently; a scatter whose model is another line's output waits for
+ * it and copies its vertices from memory instead of the file.
+ */
+bool runManifest(const string& file);
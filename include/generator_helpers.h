@@ -1,16 +1,129 @@
 #pragma once
-#include <list>
+#include <cstdio>
+#include <cstdint>
 #include <string>
+#include <vector>
+#include <functional>
 using namespace std;
 
-void addVertex(list<string>& vertices, float x, float y, float z);
-void generateTriangle(list<string>& vertices,
+// ============================================================================
+// VERTEX OUTPUT
+// ============================================================================
+
+/**
+ * Where a primitive sends its triangle-list vertices
+ */
+class VertexSink {
+public:
+    virtual ~VertexSink() {}
+    virtual void vertex(float x, float y, float z) = 0;
+    /**
+     * count vertices as consecutive x, y, z floats
+     */
+    virtual void vertexBlock(const float* xyz, size_t count) {
+        for (size_t i = 0; i < count; i++, xyz += 3) vertex(xyz[0], xyz[1], xyz[2]);
+    }
+};
+
+// Layout of the files FigureWriter writes (generator --binary)
+extern bool binaryFigures;
+
+/**
+ * Streams a .3d file under figures/ as the vertices arrive, through a fixed
+ * buffer, so memory does not grow with the figure. Text output uses the
+ * shortest decimal that reads back to the same float; the vertex count in
+ * the header is written by close() (padded when the file outgrew the buffer
+ * before the count was known).
+ */
+class FigureWriter : public VertexSink {
+public:
+    FigureWriter();
+    ~FigureWriter();
+    bool open(const string& file);
+    void vertex(float x, float y, float z) override;
+    void vertexBlock(const float* xyz, size_t count) override;
+    /**
+     * Flush, patch the header and report the figure; false on a write error
+     */
+    bool close();
+    /**
+     * Close and delete a partly written file (generation failed)
+     */
+    void discard();
+    size_t count() const { return vertexCount; }
+
+private:
+    FILE* out;
+    string path;
+    bool binary;
+    bool failed;
+    bool headerWritten;  // a placeholder header is on disk, patched by close()
+    size_t vertexCount;
+    vector<char> buffer;
+    size_t used;
+    vector<float> pending;     // text mode: single vertices, formatted a batch at a time
+    double formatMs, ioMs;     // this figure's stats, added to generatorStats by close()
+    void flush();
+    void formatPending();
+    void formatBlock(const float* xyz, size_t count);
+    void formatVertex(float x, float y, float z);
+    void writeBlock(const char* data, size_t size);
+};
+
+void addVertex(VertexSink& vertices, float x, float y, float z);
+void generateTriangle(VertexSink& vertices,
                       float x1, float y1, float z1,
                       float x2, float y2, float z2,
                       float x3, float y3, float z3);
-void generateQuad(list<string>& vertices,
+void generateQuad(VertexSink& vertices,
                   float x1, float y1, float z1,
                   float x2, float y2, float z2,
                   float x3, float y3, float z3,
                   float x4, float y4, float z4);
 bool verifyMetric(const string& name, float value, float min);
+
+/**
+ * Write an indexed .3d file under figures/: unique x, y, z floats and three
+ * indices per triangle
+ */
+bool writeIndexedFigure(const string& file, const vector<float>& coords, const vector<uint32_t>& indices);
+
+/**
+ * Read a .3d file (any layout) under figures/ into x, y, z floats, one
+ * triple per triangle-list vertex
+ */
+bool readFigure(const string& file, vector<float>& coords);
+
+// ============================================================================
+// WORKER THREADS
+// ============================================================================
+
+// Threads for the parallel parts of generation (0: one per core)
+extern int generatorThreads;
+
+int generatorWorkerCount();
+
+/**
+ * For threads that each generate a whole figure (manifest mode): the
+ * figures started on the calling thread run serially, so the threads are
+ * not oversubscribed
+ */
+void generateSeriallyOnThisThread();
+
+/**
+ * Split [0, count) into contiguous ranges and run fn(begin, end) on each,
+ * on up to generatorWorkerCount() threads (the caller works too); returns
+ * once all ranges are done
+ */
+void parallelFor(size_t count, const function<void(size_t, size_t)>& fn);
+
+/**
+ * Generate `count` items in order into vertices, where item i writes
+ * exactly itemVertices(i) vertices and emitRange(begin, end, sink) writes
+ * items [begin, end). With more than one worker, blocks of items are
+ * split across the threads, each writing into its precomputed range of a
+ * shared buffer; the output is the same as the serial run.
+ */
+void generateInOrder(size_t count, const function<size_t(size_t)>& itemVertices,
+                     const function<void(size_t, size_t, VertexSink&)>& emitRange,
+                     VertexSink& vertices);
@@ -0,0 +1,73 @@
+#pragma once
+#include <chrono>
+#include <ostream>
+#include <mutex>
+using namespace std;
+
+// ============================================================================
+// GENERATOR STATS
+// ============================================================================
+
+// Where a run's time goes (--stats and generator_bench). Off by default:
+// when on, the clock is read around each buffer of formatted vertices and
+// each I/O call.
+
+struct GeneratorStats {
+    bool enabled;
+    double formatMs;     // vertex text formatting
+    double ioMs;         // reading input figures and writing the output
+    long long vertices;  // vertices written
+    double figureMs;     // manifest: time in figures, summed over the threads running them
+    GeneratorStats() : enabled(false), formatMs(0.0), ioMs(0.0), vertices(0), figureMs(0.0) {}
+};
+
+extern GeneratorStats generatorStats;
+
+// Guards generatorStats and the per-figure report lines, which several
+// figures update at once in manifest mode
+extern mutex generatorReportLock;
+
+inline double generatorClockMs() {
+    return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Adds the lifetime of a scope to a stats bucket: one of generatorStats
+ * under its lock, or (lock NULL) a total owned by the calling thread
+ */
+struct StatsScope {
+    double& bucket;
+    mutex* lock;
+    double startMs;
+    bool active;
+    explicit StatsScope(double& b, mutex* l = &generatorReportLock)
+        : bucket(b), lock(l), startMs(0.0), active(generatorStats.enabled) {
+        if (active) startMs = generatorClockMs();
+    }
+    ~StatsScope() {
+        if (!active) return;
+        double elapsed = generatorClockMs() - startMs;
+        if (!lock) {
+            bucket += elapsed;
+            return;
+        }
+        lock_guard<mutex> guard(*lock);
+        bucket += elapsed;
+    }
+};
+
+/**
+ * Zero the counters (keeps enabled)
+ */
+void resetGeneratorStats();
+
+/**
+ * Peak resident memory of the process in MB
+ */
+double generatorPeakMemoryMB();
+
+/**
+ * Print vertices/s and the geometry/formatting/I/O split of a run that
+ * took totalMs
+ */
+void printGeneratorStats(double totalMs, ostream& out);
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include "generator_helpers.h"
+using namespace std;
+
+// ============================================================================
+// PARAMETRIC SURFACES
+// ============================================================================
+
+// The sphere, cylinder, cone, torus and ring are grids over two angles (or
+// an angle and a height). Their sines and cosines are taken once per grid
+// line from a TrigTable, and the grid is evaluated a row at a time into
+// x/y/z arrays, so the per-point work is a few multiplies in a loop the
+// compiler vectorizes.
+
+/**
+ * cos and sin of k * step for k = 0..count (the last entry closes the loop
+ * for a full turn). The angle is computed in float as the primitives always
+ * did, so the values match the per-corner calls they replace.
+ */
+struct TrigTable {
+    vector<float> cosv, sinv;
+    TrigTable(int count, float step);
+};
+
+/**
+ * One row of surface points (cols + 1 of them)
+ */
+struct GridRow {
+    vector<float> x, y, z;
+};
+
+/**
+ * Evaluate a (rows + 1) x (cols + 1) grid one row at a time and hand each
+ * band between rows r and r + 1 to emitBand, in band order. Each run of
+ * bands holds only two rows; with more than one worker thread the bands
+ * are split across threads through generateInOrder.
+ *
+ * @param evalRow       fills row r (the vectors are already sized cols + 1)
+ * @param bandVertices  exact number of vertices band r writes
+ * @param emitBand      writes the triangles of band r from its low and high rows
+ */
+void sweepGrid(int rows, int cols,
+               const function<void(int, GridRow&)>& evalRow,
+               const function<size_t(int)>& bandVertices,
+               const function<void(int, const GridRow&, const GridRow&, VertexSink&)>& emitBand,
+               VertexSink& vertices);
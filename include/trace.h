@@ -0,0 +1,165 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <vector>
+using namespace std;
+
+// ============================================================================
+// TRACE EVENTS
+// ============================================================================
+
+// Scoped timing markers shared by the engine and the generator. When
+// tracing is on (--trace <file> or the TRACE_FILE environment variable)
+// every marker is buffered and the file is written at exit in the Chrome
+// trace-event format (open it in chrome://tracing or ui.perfetto.dev).
+// When it is off a marker costs one relaxed load of a flag.
+
+struct TraceEvent {
+    const char* name;      // string literal
+    const char* category;  // string literal
+    string detail;         // file name, line, ... (may be empty)
+    double startUs;
+    double durationUs;
+    int thread;
+};
+
+struct TraceLog {
+    atomic<bool> enabled;
+    atomic<int> nextThread;
+    mutex lock;
+    vector<TraceEvent> events;
+    string file;
+    chrono::steady_clock::time_point origin;
+    TraceLog() : enabled(false), nextThread(0), origin(chrono::steady_clock::now()) {}
+};
+
+inline TraceLog& traceLog() {
+    static TraceLog log;
+    return log;
+}
+
+inline bool traceEnabled() {
+    return traceLog().enabled.load(memory_order_relaxed);
+}
+
+/**
+ * Microseconds since the trace log was created
+ */
+inline double traceNowUs() {
+    return chrono::duration<double, micro>(chrono::steady_clock::now() - traceLog().origin).count();
+}
+
+/**
+ * Small sequential id of the calling thread (0 = first thread to trace)
+ */
+inline int traceThreadId() {
+    static thread_local int id = traceLog().nextThread++;
+    return id;
+}
+
+/**
+ * Record a finished span that started at startUs (from traceNowUs())
+ */
+inline void traceComplete(const char* name, const char* category, double startUs, const char* detail = NULL) {
+    if (!traceEnabled()) return;
+    TraceEvent e;
+    e.name = name;
+    e.category = category;
+    if (detail) e.detail = detail;
+    e.startUs = startUs;
+    e.durationUs = traceNowUs() - startUs;
+    e.thread = traceThreadId();
+    TraceLog& log = traceLog();
+    lock_guard<mutex> guard(log.lock);
+    log.events.push_back(e);
+}
+
+/**
+ * Marks the lifetime of a scope as one span
+ */
+struct TraceScope {
+    const char* name;
+    const char* category;
+    const char* detail;
+    double startUs;
+    bool active;
+    TraceScope(const char* n, const char* c, const char* d = NULL) :
+        name(n), category(c), detail(d), startUs(0.0), active(traceEnabled()) {
+        if (active) startUs = traceNowUs();
+    }
+    ~TraceScope() {
+        end();
+    }
+    // End the span before the scope does
+    void end() {
+        if (active) traceComplete(name, category, startUs, detail);
+        active = false;
+    }
+};
+
+inline void traceWriteString(FILE* out, const char* s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', out);
+        fputc((unsigned char)*s < 0x20 ? ' ' : *s, out);
+    }
+    fputc('"', out);
+}
+
+/**
+ * Write the buffered events to the trace file (registered with atexit)
+ */
+inline void traceWrite() {
+    TraceLog& log = traceLog();
+    lock_guard<mutex> guard(log.lock);
+    FILE* out = fopen(log.file.c_str(), "w");
+    if (!out) {
+        fprintf(stderr, "Could not write trace file %s\n", log.file.c_str());
+        return;
+    }
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t i = 0; i < log.events.size(); i++) {
+        const TraceEvent& e = log.events[i];
+        fprintf(out, "%s{\"name\":", i ? ",\n" : "");
+        traceWriteString(out, e.name);
+        fprintf(out, ",\"cat\":");
+        traceWriteString(out, e.category);
+        fprintf(out, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+                e.startUs, e.durationUs, e.thread);
+        if (!e.detail.empty()) {
+            fprintf(out, ",\"args\":{\"detail\":");
+            traceWriteString(out, e.detail.c_str());
+            fputc('}', out);
+        }
+        fputc('}', out);
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    fprintf(stderr, "Trace written to %s (%zu events)\n", log.file.c_str(), log.events.size());
+    log.events.clear();
+}
+
+/**
+ * Start tracing into a file, written when the process exits
+ */
+inline void traceStart(const string& file) {
+    TraceLog& log = traceLog();
+    if (log.enabled) return;
+    log.file = file;
+    log.events.reserve(1 << 16);
+    traceThreadId();  // the starting thread is thread 0
+    log.enabled = true;
+    atexit(traceWrite);
+}
+
+/**
+ * Start tracing if TRACE_FILE is set
+ */
+inline void traceStartFromEnvironment() {
+    const char* file = getenv("TRACE_FILE");
+    if (file && *file) traceStart(file);
+}